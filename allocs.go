@@ -0,0 +1,205 @@
+package testaroli
+
+import (
+	"reflect"
+	"runtime"
+	"sync"
+)
+
+/*
+TrackAllocs enables counting of heap allocations for overrides, made with [Override] after
+TrackAllocs is set, see [Allocations] for details.
+*/
+var TrackAllocs = false
+
+/*
+Allocs holds the number of heap allocations, made between the first [Override] and
+[ExpectationsWereMet], see [Allocations].
+*/
+type Allocs struct {
+	Objects     uint64 // number of objects, allocated by the code under test
+	Bytes       uint64 // bytes, allocated by the code under test
+	MockObjects uint64 // number of objects, allocated by the mocks and by testaroli to call them
+	MockBytes   uint64 // bytes, allocated by the mocks and by testaroli to call them
+}
+
+type allocCount struct {
+	objects uint64
+	bytes   uint64
+}
+
+func (a allocCount) add(b allocCount) allocCount {
+	return allocCount{a.objects + b.objects, a.bytes + b.bytes}
+}
+
+// sub returns difference of counters, which never goes below zero
+func (a allocCount) sub(b allocCount) allocCount {
+	var d allocCount
+	if a.objects > b.objects {
+		d.objects = a.objects - b.objects
+	}
+	if a.bytes > b.bytes {
+		d.bytes = a.bytes - b.bytes
+	}
+
+	return d
+}
+
+var allocWindow struct {
+	mu       sync.Mutex
+	active   bool
+	start    allocCount
+	end      allocCount
+	mock     allocCount // allocated by the mocks
+	excluded allocCount // allocated by Override
+}
+
+// sinks to make calibration allocations escape to the heap
+var (
+	argsSink  []reflect.Value
+	valueSink reflect.Value
+)
+
+/*
+Allocations returns the number of heap allocations, made by the code under test and by
+the mocks, between the first [Override] and [ExpectationsWereMet], or since the first
+Override, if ExpectationsWereMet wasn't called yet. It allows to check the allocation
+budget of the code, which dependencies are overridden:
+
+	func TestHandlerAllocs(t *testing.T) {
+	    TrackAllocs = true
+	    defer func() { TrackAllocs = false }()
+
+	    Override(TestingContext(t), db.Load, Once, func(key string) ([]byte, error) {
+	        Expectation()
+	        return []byte("foo"), nil
+	    })
+
+	    handler(req)
+
+	    if err := ExpectationsWereMet(); err != nil {
+	        t.Error(err)
+	    }
+	    if a := Allocations(); a.Objects > 3 {
+	        t.Errorf("handler allocates %d objects", a.Objects)
+	    }
+	}
+
+Allocations of Override itself are not counted, and allocations of the mocks, including
+ones, made by [Expectation] and by reflection to call the mocks, are counted separately
+from the code under test. To count them, mocks are called through the wrapper, which reads
+[runtime.MemStats] before and after the call, so calls of overridden functions become much
+slower. Functions, too short to be patched with the jump to the wrapper, call the mocks
+directly, so allocations of such mocks are counted as the ones of the code under test.
+
+Allocation counters are process-wide, so allocations of all goroutines, which run at the
+same time, including the test itself, are counted, and tests, which check allocations,
+must not run in parallel.
+*/
+func Allocations() Allocs {
+	allocWindow.mu.Lock()
+	defer allocWindow.mu.Unlock()
+
+	end := allocWindow.end
+	if allocWindow.active {
+		end = readAllocs()
+	}
+	code := end.sub(allocWindow.start).sub(allocWindow.excluded).sub(allocWindow.mock)
+
+	return Allocs{
+		Objects:     code.objects,
+		Bytes:       code.bytes,
+		MockObjects: allocWindow.mock.objects,
+		MockBytes:   allocWindow.mock.bytes,
+	}
+}
+
+// readAllocs returns current allocation counters, unlike runtime/metrics, which are updated
+// when span is allocated, MemStats counts every allocation
+func readAllocs() allocCount {
+	var ms runtime.MemStats
+	runtime.ReadMemStats(&ms)
+
+	return allocCount{ms.Mallocs, ms.TotalAlloc}
+}
+
+// excludeAllocs starts the window of allocation counting, or, if it is already started,
+// excludes allocations since <start> from it
+func excludeAllocs(start allocCount) {
+	allocWindow.mu.Lock()
+	defer allocWindow.mu.Unlock()
+
+	if !allocWindow.active {
+		allocWindow.active = true
+		allocWindow.mock, allocWindow.excluded = allocCount{}, allocCount{}
+		allocWindow.start = readAllocs()
+		return
+	}
+	allocWindow.excluded = allocWindow.excluded.add(readAllocs().sub(start))
+}
+
+// endAllocWindow stops counting allocations
+func endAllocWindow() {
+	allocWindow.mu.Lock()
+	defer allocWindow.mu.Unlock()
+
+	if allocWindow.active {
+		allocWindow.end = readAllocs()
+		allocWindow.active = false
+	}
+}
+
+// withAllocCount returns the function, which makes <call> of function of type <typ>, counting
+// allocations of the call as mock allocations
+func withAllocCount(typ reflect.Type, call mockCall) mockCall {
+	args := argsAllocs(typ)
+
+	return func(in []reflect.Value) []reflect.Value {
+		start := readAllocs()
+		res := call(in)
+		d := readAllocs().sub(start).add(args)
+
+		allocWindow.mu.Lock()
+		if allocWindow.active {
+			allocWindow.mock = allocWindow.mock.add(d)
+		}
+		allocWindow.mu.Unlock()
+
+		return res
+	}
+}
+
+/*
+argsAllocs returns allocations, made by reflection to pass the arguments of function of type
+<typ> to the wrapper, made with [reflect.MakeFunc], before the wrapper starts. It makes the same
+allocations - the slice of arguments and the copies of arguments, which aren't pointers.
+*/
+func argsAllocs(typ reflect.Type) allocCount {
+	start := readAllocs()
+	if typ.NumIn() > 0 {
+		argsSink = make([]reflect.Value, 0, typ.NumIn())
+	}
+	for i := 0; i < typ.NumIn(); i++ {
+		if in := typ.In(i); in.Size() > 0 && !pointerShaped(in) {
+			valueSink = reflect.New(in)
+		}
+	}
+	d := readAllocs().sub(start)
+	argsSink, valueSink = nil, reflect.Value{}
+
+	return d
+}
+
+// pointerShaped reports whether values of the type are stored in interface directly
+func pointerShaped(typ reflect.Type) bool {
+	switch typ.Kind() {
+	case reflect.Pointer, reflect.Chan, reflect.Map, reflect.Func, reflect.UnsafePointer:
+		return true
+	case reflect.Array:
+		return typ.Len() == 1 && pointerShaped(typ.Elem())
+	case reflect.Struct:
+		return typ.NumField() == 1 && pointerShaped(typ.Field(0).Type)
+	}
+
+	return false
+}
@@ -0,0 +1,49 @@
+package testaroli
+
+import (
+	"testing"
+)
+
+var (
+	allocSink []*int
+	ptrSink   **int // objects with pointers aren't combined by tiny allocator, so counts are exact
+)
+
+func allocate(n int) []*int {
+	res := make([]*int, n)
+	for i := range res {
+		res[i] = new(int)
+	}
+	return res
+}
+
+func allocHandler(n int) int {
+	allocSink = make([]*int, 2)
+	ptrSink = new(*int)
+	return len(allocate(n))
+}
+
+func TestAllocations(t *testing.T) {
+	TrackAllocs = true
+	defer func() { TrackAllocs = false }()
+
+	Override(TestingContext(t), allocate, Once, func(n int) []*int {
+		Expectation().CheckArgs(n)
+		return make([]*int, n)
+	})(10)
+
+	if allocHandler(10) != 10 {
+		t.Errorf("unexpected result")
+	}
+	testError(t, nil, ExpectationsWereMet())
+
+	a := Allocations()
+	// slice of 2 pointers and pointer
+	if a.Objects != 2 || a.Bytes != 2*8+8 {
+		t.Errorf("unexpected allocations of the code %d objects, %d bytes", a.Objects, a.Bytes)
+	}
+	// slice of 10 pointers, and allocations of Expectation and reflection
+	if a.MockObjects < 1 || a.MockBytes < 10*8 {
+		t.Errorf("unexpected allocations of the mock %d objects, %d bytes", a.MockObjects, a.MockBytes)
+	}
+}
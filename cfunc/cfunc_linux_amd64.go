@@ -0,0 +1,172 @@
+//go:build cgo
+
+package cfunc
+
+/*
+#cgo LDFLAGS: -ldl
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <link.h>
+#include <stdlib.h>
+
+// lookup_symbol returns the address of dynamic symbol <name> and sets <size> to its size, if known
+static void *lookup_symbol(const char *name, size_t *size) {
+    void *addr = dlsym(RTLD_DEFAULT, name);
+    *size = 0;
+    if (addr != NULL) {
+        Dl_info info;
+        const ElfW(Sym) *sym = NULL;
+        if (dladdr1(addr, &info, (void **)&sym, RTLD_DL_SYMENT) != 0 && sym != NULL) {
+            *size = sym->st_size;
+        }
+    }
+    return addr;
+}
+*/
+import "C"
+
+import (
+	"context"
+	"debug/elf"
+	"encoding/binary"
+	"fmt"
+	"reflect"
+	"runtime"
+	"sync"
+	"unsafe"
+
+	"github.com/qrdl/testaroli"
+)
+
+// JMP [RIP+0]; <address> - C functions can be too far from the replacement for relative JMP
+const absJmpLength = 14
+
+var absJmpCode = []byte{0xFF, 0x25, 0, 0, 0, 0}
+
+// symbols of the executable, read on first lookup of the symbol, which isn't dynamic
+var exeSymbols struct {
+	once  sync.Once
+	syms  []elf.Symbol
+	slide uintptr // difference between symbol values and actual addresses
+	err   error
+}
+
+/*
+Override overrides C function <symbol> with C function <replacement> until the test, which
+context is passed to Override, completes. Function is overridden for all callers - for Go code,
+calling it with cgo, and for C code, including other shared libraries, so it allows to stub
+expensive native libraries, like compression or crypto, in unit tests.
+
+Replacement is the C function with the same signature, or Go function, exported with //export,
+so cgo generates C entry for it, which adapts C calling convention to Go one. Neither C
+functions nor exported Go functions can be defined in test files, so replacement has to be
+defined in regular file of the package, which uses cgo, e.g. one, which is built only with
+build tag, like the test, which uses it, and passed as the pointer:
+
+	// compress_stub.go
+	//go:build cgo && stub
+
+	package compress
+
+	// extern size_t lzCompressStub(char *, size_t, char *, size_t);
+	import "C"
+	import "unsafe"
+
+	var lzCompressStubPtr = unsafe.Pointer(C.lzCompressStub)
+
+	//export lzCompressStub
+	func lzCompressStub(src *C.char, srcLen C.size_t, dst *C.char, dstLen C.size_t) C.size_t {
+	    return 0
+	}
+
+	// compress_stub_test.go
+	//go:build cgo && stub
+
+	func TestCompressFailed(t *testing.T) {
+	    cfunc.Override(testaroli.TestingContext(t), "lz_compress", lzCompressStubPtr)
+	    ...
+	}
+
+Symbol is looked up among dynamic symbols, like with dlsym(), and then in the symbol table of
+the executable. go test strips the symbol table, unless test binary is kept with -c or -o, so
+to override functions, linked statically, link the package with `#cgo LDFLAGS: -rdynamic`,
+which makes them dynamic symbols. C compiler can inline functions into the callers in the same
+object file, and such calls aren't overridden, so these functions must be declared with noinline
+attribute.
+Unlike mocks for [testaroli.Override], replacement isn't a part of the chain of expectations,
+so it mustn't call [testaroli.Expectation].
+*/
+func Override(ctx context.Context, symbol string, replacement unsafe.Pointer) {
+	if replacement == nil {
+		panic("replacement cannot be nil")
+	}
+
+	addr, size, err := resolveSymbol(symbol)
+	if err != nil {
+		panic(err.Error())
+	}
+	if size > 0 && size < absJmpLength {
+		panic(fmt.Sprintf("function %s is too short to be overridden", symbol))
+	}
+
+	newPrologue := make([]byte, absJmpLength)
+	copy(newPrologue, absJmpCode)
+	binary.NativeEndian.PutUint64(newPrologue[len(absJmpCode):], uint64(uintptr(replacement)))
+
+	testaroli.ReplaceCode(ctx, addr, newPrologue)
+}
+
+// resolveSymbol returns the address of function <name> and its size, or zero, if size is unknown
+func resolveSymbol(name string) (unsafe.Pointer, uint64, error) {
+	cName := C.CString(name)
+	defer C.free(unsafe.Pointer(cName))
+	var size C.size_t
+	if addr := C.lookup_symbol(cName, &size); addr != nil {
+		return addr, uint64(size), nil
+	}
+
+	return exeSymbol(name)
+}
+
+// exeSymbol looks up function <name> in the symbol table of the executable
+func exeSymbol(name string) (unsafe.Pointer, uint64, error) {
+	exeSymbols.once.Do(loadExeSymbols)
+	if exeSymbols.err != nil {
+		return nil, 0, fmt.Errorf("cannot find symbol %s: %w", name, exeSymbols.err)
+	}
+
+	for _, sym := range exeSymbols.syms {
+		if sym.Name == name && elf.ST_TYPE(sym.Info) == elf.STT_FUNC && sym.Value != 0 {
+			addr := uintptr(sym.Value) + exeSymbols.slide
+			return *(*unsafe.Pointer)(unsafe.Pointer(&addr)), sym.Size, nil
+		}
+	}
+
+	return nil, 0, fmt.Errorf("cannot find symbol %s", name)
+}
+
+func loadExeSymbols() {
+	f, err := elf.Open("/proc/self/exe")
+	if err != nil {
+		exeSymbols.err = err
+		return
+	}
+	defer f.Close()
+
+	exeSymbols.syms, exeSymbols.err = f.Symbols()
+	if exeSymbols.err != nil {
+		return
+	}
+
+	// position-independent executable is loaded at random address, so symbol values are
+	// shifted by the same offset as the address of this function
+	entry := reflect.ValueOf(loadExeSymbols).Pointer()
+	name := runtime.FuncForPC(entry).Name()
+	for _, sym := range exeSymbols.syms {
+		if sym.Name == name {
+			exeSymbols.slide = entry - uintptr(sym.Value)
+			return
+		}
+	}
+	exeSymbols.err = fmt.Errorf("cannot find symbol %s of the executable", name)
+}
@@ -0,0 +1,46 @@
+//go:build cgo
+
+package cfunc
+
+import (
+	"debug/elf"
+	"errors"
+	"reflect"
+	"testing"
+	"unsafe"
+
+	"github.com/qrdl/testaroli"
+)
+
+//go:noinline
+func target() int {
+	return 42
+}
+
+func TestResolveSymbol(t *testing.T) {
+	// dynamic symbol
+	if addr, size, err := resolveSymbol("getpid"); err != nil || addr == nil || size == 0 {
+		t.Errorf("cannot resolve dynamic symbol: %v", err)
+	}
+
+	// symbol of the executable, go test strips symbol table, unless binary is kept
+	addr, _, err := resolveSymbol("github.com/qrdl/testaroli/cfunc.target")
+	if errors.Is(err, elf.ErrNoSymbols) {
+		t.Log("executable has no symbol table")
+	} else if err != nil || addr != reflect.ValueOf(target).UnsafePointer() {
+		t.Errorf("unexpected address %p of the symbol: %v", addr, err)
+	}
+
+	if _, _, err := resolveSymbol("no_such_symbol"); err == nil {
+		t.Errorf("unknown symbol resolved")
+	}
+}
+
+func TestOverrideInvalid(t *testing.T) {
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("unknown symbol overridden")
+		}
+	}()
+	Override(testaroli.TestingContext(t), "no_such_symbol", unsafe.Pointer(reflect.ValueOf(target).Pointer()))
+}
@@ -0,0 +1,7 @@
+/*
+Package cfunc overrides C functions, linked into the test binary, see [Override]. It is separate
+from package testaroli, so only tests, which override C functions, need cgo and C compiler.
+
+Override is available only on Linux / x86_64 with cgo enabled.
+*/
+package cfunc
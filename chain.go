@@ -0,0 +1,122 @@
+package testaroli
+
+// number of expectations in the chunk of the chain
+const chainChunkSize = 64
+
+type chainChunk struct {
+	items [chainChunkSize]Expect
+	next  *chainChunk
+}
+
+/*
+chain is FIFO queue of expectations. Expectations are stored by value in fixed-size chunks,
+so adding expectation doesn't allocate separate object for it and doesn't copy the ones
+already in the chain, and both adding and removing are O(1). Chunk is released as soon as
+all its expectations are consumed, so even very long chains don't keep consumed
+expectations in memory.
+
+Pointers to expectations are valid only while they are in the chain: when the chain becomes
+empty, its last chunk is cleared and reused, so expectation must be copied before it is
+popped, or, if other goroutines can pop it, before chainMu is unlocked.
+*/
+type chain struct {
+	head  *chainChunk
+	tail  *chainChunk
+	first int // index of the first expectation in head chunk
+	next  int // index of the next free slot in tail chunk
+	size  int
+	spare *chainChunk // chunk of emptied chain, kept for reuse
+}
+
+// push adds new expectation to the end of the chain and returns pointer to it
+func (c *chain) push(e Expect) *Expect {
+	if c.tail == nil || c.next == chainChunkSize {
+		chunk := c.spare
+		c.spare = nil
+		if chunk == nil {
+			chunk = &chainChunk{}
+		}
+		if c.tail == nil {
+			c.head = chunk
+			c.first = 0
+		} else {
+			c.tail.next = chunk
+		}
+		c.tail = chunk
+		c.next = 0
+	}
+	slot := &c.tail.items[c.next]
+	*slot = e
+	c.next++
+	c.size++
+
+	return slot
+}
+
+// front returns the first expectation in the chain, or nil if chain is empty
+func (c *chain) front() *Expect {
+	if c.size == 0 {
+		return nil
+	}
+	return &c.head.items[c.first]
+}
+
+// back returns the last expectation in the chain, or nil if chain is empty
+func (c *chain) back() *Expect {
+	if c.size == 0 {
+		return nil
+	}
+	return &c.tail.items[c.next-1]
+}
+
+// at returns i-th expectation in the chain, or nil if there is no such
+func (c *chain) at(i int) *Expect {
+	if i >= c.size {
+		return nil
+	}
+	chunk, idx := c.head, c.first+i
+	for idx >= chainChunkSize {
+		chunk, idx = chunk.next, idx-chainChunkSize
+	}
+
+	return &chunk.items[idx]
+}
+
+/*
+pop removes the first expectation from the chain. Removed expectation isn't cleared, as
+it is cleared together with the chunk, which can be reused, so pointer to it mustn't be used
+after pop.
+*/
+func (c *chain) pop() {
+	if c.size == 0 {
+		return
+	}
+	c.size--
+	c.first++
+	if c.size == 0 {
+		c.clear()
+		return
+	}
+	if c.first == chainChunkSize {
+		c.head = c.head.next
+		c.first = 0
+	}
+}
+
+func (c *chain) len() int {
+	return c.size
+}
+
+/*
+clear removes all expectations from the chain. When test repeatedly sets up short chains,
+like fuzz target does for each input, the chunk is reused rather than allocated each time.
+*/
+func (c *chain) clear() {
+	spare := c.spare
+	if c.tail != nil {
+		spare = c.tail
+		spare.next = nil
+		clear(spare.items[:c.next]) // don't keep references to contexts etc. of old expectations
+	}
+	*c = chain{spare: spare}
+}
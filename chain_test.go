@@ -0,0 +1,61 @@
+package testaroli
+
+import (
+	"testing"
+)
+
+func TestChain(t *testing.T) {
+	var c chain
+	if c.front() != nil || c.back() != nil || c.len() != 0 {
+		t.Errorf("chain isn't empty")
+	}
+
+	const total = chainChunkSize*3 + 5
+	for i := 0; i < total; i++ {
+		c.push(Expect{expCount: i})
+	}
+	if c.len() != total || c.back().expCount != total-1 {
+		t.Errorf("unexpected chain length %d", c.len())
+	}
+
+	for i := 0; i < total; i++ {
+		if e := c.front(); e == nil || e.expCount != i {
+			t.Fatalf("unexpected expectation %d", i)
+		}
+		c.pop()
+		if i > 0 && i%chainChunkSize == 0 && c.head == nil {
+			t.Fatalf("chunk released too early")
+		}
+	}
+	if c.front() != nil || c.len() != 0 || c.head != nil {
+		t.Errorf("chain isn't empty")
+	}
+
+	// last chunk is reused
+	if e := c.push(Expect{expCount: 42}); c.front() != e || c.back() != e || e.expCount != 42 {
+		t.Errorf("unexpected expectation after reuse")
+	}
+	if c.head != c.tail || c.head.items[1].expCount != 0 {
+		t.Errorf("chunk isn't cleared for reuse")
+	}
+	c.clear()
+	if c.len() != 0 {
+		t.Errorf("chain isn't empty")
+	}
+}
+
+func TestLongChain(t *testing.T) {
+	const total = 100000
+	ctx := TestingContext(t)
+	for i := 0; i < total; i++ {
+		Override(ctx, baz, Once, func(i int) error {
+			Expectation().CheckArgs(i)
+			return nil
+		})(i)
+	}
+
+	for i := 0; i < total; i++ {
+		testError(t, nil, baz(i))
+	}
+	testError(t, nil, ExpectationsWereMet())
+}
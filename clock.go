@@ -0,0 +1,381 @@
+package testaroli
+
+import (
+	"context"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+/*
+Clock is a virtual clock, which replaces the wall clock for the duration of the test.
+See [FakeClock] for details.
+*/
+type Clock struct {
+	mu      sync.Mutex
+	now     time.Time
+	timers  []*fakeTimer
+	byTimer map[*time.Timer]*fakeTimer
+	byTick  map[*time.Ticker]*fakeTimer
+	patches []*patch
+	// patches for methods that may be called for real timers, created before clock was installed
+	timerStop   *patch
+	timerReset  *patch
+	tickerStop  *patch
+	tickerReset *patch
+	// patches for functions, which create real timers behind the virtual ones
+	newTimer  *patch
+	newTicker *patch
+	afterFunc *patch
+}
+
+type fakeTimer struct {
+	when   time.Time
+	period time.Duration    // non-zero for tickers
+	ch     chan time.Time   // created by virtual clock, it replaces the channel of real timer
+	orgCh  <-chan time.Time // channel of real timer, put back when clock is restored
+	fn     func()           // set for timers, created with time.AfterFunc
+	active bool
+}
+
+var activeClock atomic.Pointer[Clock]
+
+/*
+FakeClock overrides [time.Now], [time.Sleep], [time.NewTimer], [time.NewTicker], [time.AfterFunc]
+and methods of [time.Timer] and [time.Ticker] to use virtual clock instead of the wall one.
+Functions like [time.Since], [time.Until], [time.After] and [time.Tick] use overridden functions
+internally, so they use virtual clock too.
+
+Virtual clock starts at current wall time and only moves when [Clock.Advance] or [Clock.Set]
+is called, or when code calls [time.Sleep] - instead of blocking, it advances the clock
+by the requested duration. Timers and tickers fire when clock reaches their deadline, so
+the code with backoffs, TTLs and rate limits can be tested without waiting for real.
+
+	func TestCacheExpiry(t *testing.T) {
+	    clock := FakeClock(TestingContext(t))
+
+	    cache.Put("foo", "bar") // entry with 1 minute TTL
+	    clock.Advance(2 * time.Minute)
+	    if _, ok := cache.Get("foo"); ok {
+	        t.Error("entry hasn't expired")
+	    }
+	}
+
+Ticks of the ticker, which are due before the deadline of any other timer, are coalesced, like
+real ticker drops ticks, when nobody reads them, so advancing clock by a long period is cheap.
+
+Original functions are restored when test, which context is passed to FakeClock, completes.
+Timers and tickers, created with virtual clock, are backed by the real stopped ones, but
+virtual clock sends to channels it creates, so real timers aren't touched. When the clock is
+restored, channels of real timers are put back, dropping values, which weren't received, so
+after that, timers can be stopped and reset like any real timer.
+Only one virtual clock can be active at any time. Like with [Override], it is necessary to
+disable function inlining to make FakeClock work.
+*/
+func FakeClock(ctx context.Context) *Clock {
+	t := Testing(ctx)
+
+	c := &Clock{
+		now:     time.Now().Round(0), // strip monotonic reading
+		byTimer: map[*time.Timer]*fakeTimer{},
+		byTick:  map[*time.Ticker]*fakeTimer{},
+	}
+	if !activeClock.CompareAndSwap(nil, c) {
+		panic("Virtual clock is already active")
+	}
+
+	c.timerStop = newPatch((*time.Timer).Stop, fakeTimerStop)
+	c.timerReset = newPatch((*time.Timer).Reset, fakeTimerReset)
+	c.tickerStop = newPatch((*time.Ticker).Stop, fakeTickerStop)
+	c.tickerReset = newPatch((*time.Ticker).Reset, fakeTickerReset)
+	c.newTimer = newPatch(time.NewTimer, fakeNewTimer)
+	c.newTicker = newPatch(time.NewTicker, fakeNewTicker)
+	c.afterFunc = newPatch(time.AfterFunc, fakeAfterFunc)
+	c.patches = []*patch{
+		newPatch(time.Now, fakeNow),
+		newPatch(time.Sleep, fakeSleep),
+		c.newTimer,
+		c.newTicker,
+		c.afterFunc,
+		c.timerStop,
+		c.timerReset,
+		c.tickerStop,
+		c.tickerReset,
+	}
+
+	t.Cleanup(c.restore)
+
+	return c
+}
+
+/*
+Now returns current time of virtual clock.
+*/
+func (c *Clock) Now() time.Time {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	return c.now
+}
+
+/*
+Advance moves virtual clock forward by <d>, firing all timers and tickers with deadlines
+within this period, in order of their deadlines.
+*/
+func (c *Clock) Advance(d time.Duration) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	c.advanceTo(c.now.Add(d))
+}
+
+/*
+Set sets virtual clock to <t>. If <t> is after current virtual time, all timers and tickers with
+deadlines up to <t> are fired.
+*/
+func (c *Clock) Set(t time.Time) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	c.advanceTo(t.Round(0))
+}
+
+func (c *Clock) advanceTo(end time.Time) {
+	for {
+		var next *fakeTimer
+		for _, t := range c.timers {
+			if t.active && !t.when.After(end) && (next == nil || t.when.Before(next.when)) {
+				next = t
+			}
+		}
+		if next == nil {
+			break
+		}
+		if next.when.After(c.now) {
+			c.now = next.when
+		}
+		ticks := int64(1)
+		if next.period > 0 {
+			// channel holds only one tick, so ticks before any other deadline are fired at once
+			limit := end
+			for _, t := range c.timers {
+				if t != next && t.active && t.when.Before(limit) {
+					limit = t.when
+				}
+			}
+			ticks += int64(limit.Sub(next.when) / next.period)
+		}
+		c.fire(next, ticks)
+	}
+	c.now = end
+}
+
+// fire fires the timer, tickers are moved by <ticks> periods
+func (c *Clock) fire(t *fakeTimer, ticks int64) {
+	if t.period > 0 {
+		t.when = t.when.Add(time.Duration(ticks) * t.period)
+	} else {
+		t.active = false
+		c.forget(t)
+	}
+
+	if t.fn != nil {
+		go t.fn()
+		return
+	}
+	// like with real timers, value is dropped if nobody has read the previous one
+	select {
+	case t.ch <- c.now:
+	default:
+	}
+}
+
+func (c *Clock) schedule(t *fakeTimer, d time.Duration) bool {
+	wasActive := t.active
+	t.when = c.now.Add(d)
+	if !t.active {
+		t.active = true
+		c.timers = append(c.timers, t)
+	}
+	return wasActive
+}
+
+func (c *Clock) stop(t *fakeTimer) bool {
+	wasActive := t.active
+	t.active = false
+	c.forget(t)
+	return wasActive
+}
+
+// forget removes inactive timer from the list of scheduled ones
+func (c *Clock) forget(t *fakeTimer) {
+	for i := range c.timers {
+		if c.timers[i] == t {
+			c.timers[i] = c.timers[len(c.timers)-1]
+			c.timers[len(c.timers)-1] = nil
+			c.timers = c.timers[:len(c.timers)-1]
+			return
+		}
+	}
+}
+
+func (c *Clock) restore() {
+	c.mu.Lock()
+	for timer, ft := range c.byTimer {
+		if ft.ch != nil { // timers, created with time.AfterFunc, have no channel
+			timer.C = ft.orgCh
+		}
+	}
+	for ticker, ft := range c.byTick {
+		ticker.C = ft.orgCh
+	}
+	c.mu.Unlock()
+
+	for _, p := range c.patches {
+		p.remove()
+	}
+	activeClock.Store(nil)
+}
+
+// Mocks below are plain functions, not closures, because mock is executed in the scope of
+// original function, so they find virtual clock through the package-level variable.
+
+func fakeNow() time.Time {
+	return activeClock.Load().Now()
+}
+
+func fakeSleep(d time.Duration) {
+	if d <= 0 {
+		return
+	}
+	activeClock.Load().Advance(d)
+}
+
+/*
+realTimer returns the timer, created by the original function of <newTimer> and stopped, so
+after the clock is restored, Stop and Reset work like for any other real timer.
+*/
+func realTimer[T any](c *Clock, newTimer *patch, create func(org T) *time.Timer) *time.Timer {
+	var timer *time.Timer
+	original(newTimer, func(org T) { timer = create(org) })
+	original(c.timerStop, func(stop func(*time.Timer) bool) { stop(timer) })
+
+	return timer
+}
+
+func fakeNewTimer(d time.Duration) *time.Timer {
+	c := activeClock.Load()
+	timer := realTimer(c, c.newTimer, func(newTimer func(time.Duration) *time.Timer) *time.Timer {
+		return newTimer(time.Hour)
+	})
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	ft := &fakeTimer{ch: make(chan time.Time, 1), orgCh: timer.C}
+	timer.C = ft.ch
+	c.byTimer[timer] = ft
+	c.schedule(ft, d)
+	c.advanceTo(c.now) // fire immediately if d <= 0
+
+	return timer
+}
+
+func fakeAfterFunc(d time.Duration, f func()) *time.Timer {
+	c := activeClock.Load()
+	timer := realTimer(c, c.afterFunc, func(afterFunc func(time.Duration, func()) *time.Timer) *time.Timer {
+		return afterFunc(time.Hour, f)
+	})
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	ft := &fakeTimer{fn: f}
+	c.byTimer[timer] = ft
+	c.schedule(ft, d)
+	c.advanceTo(c.now)
+
+	return timer
+}
+
+func fakeNewTicker(d time.Duration) *time.Ticker {
+	if d <= 0 {
+		panic("non-positive interval for NewTicker")
+	}
+	c := activeClock.Load()
+	var ticker *time.Ticker
+	original(c.newTicker, func(newTicker func(time.Duration) *time.Ticker) { ticker = newTicker(d) })
+	original(c.tickerStop, func(stop func(*time.Ticker)) { stop(ticker) })
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	ft := &fakeTimer{ch: make(chan time.Time, 1), orgCh: ticker.C, period: d}
+	ticker.C = ft.ch
+	c.byTick[ticker] = ft
+	c.schedule(ft, d)
+
+	return ticker
+}
+
+func fakeTimerStop(t *time.Timer) bool {
+	c := activeClock.Load()
+	c.mu.Lock()
+	ft, ok := c.byTimer[t]
+	if ok {
+		defer c.mu.Unlock()
+		return c.stop(ft)
+	}
+	c.mu.Unlock()
+
+	// real timer, created before virtual clock was installed
+	var res bool
+	original(c.timerStop, func(stop func(*time.Timer) bool) { res = stop(t) })
+	return res
+}
+
+func fakeTimerReset(t *time.Timer, d time.Duration) bool {
+	c := activeClock.Load()
+	c.mu.Lock()
+	ft, ok := c.byTimer[t]
+	if ok {
+		defer c.mu.Unlock()
+		res := c.schedule(ft, d)
+		c.advanceTo(c.now)
+		return res
+	}
+	c.mu.Unlock()
+
+	var res bool
+	original(c.timerReset, func(reset func(*time.Timer, time.Duration) bool) { res = reset(t, d) })
+	return res
+}
+
+func fakeTickerStop(t *time.Ticker) {
+	c := activeClock.Load()
+	c.mu.Lock()
+	ft, ok := c.byTick[t]
+	if ok {
+		defer c.mu.Unlock()
+		c.stop(ft)
+		return
+	}
+	c.mu.Unlock()
+
+	original(c.tickerStop, func(stop func(*time.Ticker)) { stop(t) })
+}
+
+func fakeTickerReset(t *time.Ticker, d time.Duration) {
+	if d <= 0 {
+		panic("non-positive interval for Ticker.Reset")
+	}
+	c := activeClock.Load()
+	c.mu.Lock()
+	ft, ok := c.byTick[t]
+	if ok {
+		defer c.mu.Unlock()
+		ft.period = d
+		c.schedule(ft, d)
+		return
+	}
+	c.mu.Unlock()
+
+	original(c.tickerReset, func(reset func(*time.Ticker, time.Duration)) { reset(t, d) })
+}
@@ -0,0 +1,205 @@
+package testaroli
+
+import (
+	"testing"
+	"time"
+)
+
+func TestClockNow(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	start := time.Now()
+	if !start.Equal(clock.Now()) {
+		t.Errorf("time.Now() returned %v, virtual clock is at %v", start, clock.Now())
+	}
+	clock.Advance(time.Hour)
+	if d := time.Since(start); d != time.Hour {
+		t.Errorf("expected 1h to pass, got %v", d)
+	}
+}
+
+func TestClockSleep(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	start := clock.Now()
+	time.Sleep(24 * time.Hour)
+	if d := clock.Now().Sub(start); d != 24*time.Hour {
+		t.Errorf("expected 24h to pass, got %v", d)
+	}
+}
+
+func TestClockTimer(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	timer := time.NewTimer(time.Minute)
+	clock.Advance(59 * time.Second)
+	select {
+	case <-timer.C:
+		t.Error("timer fired too early")
+	default:
+	}
+	clock.Advance(time.Second)
+	select {
+	case <-timer.C:
+	default:
+		t.Error("timer hasn't fired")
+	}
+
+	if timer.Reset(time.Second) {
+		t.Error("expired timer reported as active")
+	}
+	if !timer.Stop() {
+		t.Error("active timer reported as expired")
+	}
+	clock.Advance(time.Minute)
+	select {
+	case <-timer.C:
+		t.Error("stopped timer has fired")
+	default:
+	}
+}
+
+func TestClockAfter(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	ch := time.After(time.Second)
+	clock.Advance(time.Second)
+	select {
+	case <-ch:
+	default:
+		t.Error("timer hasn't fired")
+	}
+}
+
+func TestClockAfterFunc(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	done := make(chan struct{})
+	time.AfterFunc(time.Second, func() { close(done) })
+	clock.Advance(time.Second)
+	<-done
+}
+
+func TestClockTicker(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	ticker := time.NewTicker(time.Second)
+	start := clock.Now()
+	for i := 1; i <= 3; i++ {
+		clock.Advance(time.Second)
+		tick := <-ticker.C
+		if d := tick.Sub(start); d != time.Duration(i)*time.Second {
+			t.Errorf("tick %d came at %v", i, d)
+		}
+	}
+	ticker.Stop()
+	clock.Advance(time.Second)
+	select {
+	case <-ticker.C:
+		t.Error("stopped ticker has ticked")
+	default:
+	}
+}
+
+func TestClockTickerCoalesced(t *testing.T) {
+	clock := FakeClock(TestingContext(t))
+
+	ticker := time.NewTicker(time.Millisecond)
+	timer := time.NewTimer(time.Minute)
+	start := clock.Now()
+	clock.Advance(24 * time.Hour)
+	if d := (<-ticker.C).Sub(start); d != time.Millisecond {
+		t.Errorf("first tick came at %v", d)
+	}
+	if d := (<-timer.C).Sub(start); d != time.Minute {
+		t.Errorf("timer fired at %v", d)
+	}
+	select {
+	case <-ticker.C:
+		t.Error("ticks weren't coalesced")
+	default:
+	}
+	clock.Advance(time.Millisecond)
+	if d := (<-ticker.C).Sub(start); d != 24*time.Hour+time.Millisecond {
+		t.Errorf("tick came at %v", d)
+	}
+}
+
+func TestClockTimerAfterRestore(t *testing.T) {
+	var timer *time.Timer
+	var ticker *time.Ticker
+	t.Run("virtual", func(t *testing.T) {
+		FakeClock(TestingContext(t))
+		timer = time.NewTimer(time.Hour)
+		ticker = time.NewTicker(time.Hour)
+	})
+
+	// timers are real ones now
+	if timer.Stop() {
+		t.Error("virtual timer is active after clock is restored")
+	}
+	timer.Reset(time.Millisecond)
+	<-timer.C
+	ticker.Reset(time.Millisecond)
+	<-ticker.C
+	ticker.Stop()
+}
+
+func TestClockTimerChannel(t *testing.T) {
+	var timer *time.Timer
+	var virtualCh <-chan time.Time
+	t.Run("virtual", func(t *testing.T) {
+		clock := FakeClock(TestingContext(t))
+		timer = time.NewTimer(time.Second)
+		virtualCh = timer.C        // channel, virtual clock sends to
+		clock.Advance(time.Second) // value isn't received
+	})
+
+	// real timer never got the value, sent by virtual clock, to its channel
+	if timer.C == virtualCh {
+		t.Error("virtual clock sends to the channel of real timer")
+	}
+	select {
+	case <-timer.C:
+		t.Error("value, sent by virtual clock, is received from real timer")
+	default:
+	}
+	timer.Reset(time.Millisecond)
+	<-timer.C
+}
+
+func TestClockRealTimer(t *testing.T) {
+	timer := time.NewTimer(time.Hour)
+	FakeClock(TestingContext(t))
+
+	if !timer.Stop() {
+		t.Error("real timer wasn't stopped")
+	}
+}
+
+func TestClockRestore(t *testing.T) {
+	var virtual time.Time
+	t.Run("virtual", func(t *testing.T) {
+		clock := FakeClock(TestingContext(t))
+		clock.Set(time.Date(2000, 1, 1, 0, 0, 0, 0, time.UTC))
+		virtual = time.Now()
+	})
+
+	if !virtual.Equal(time.Date(2000, 1, 1, 0, 0, 0, 0, time.UTC)) {
+		t.Errorf("unexpected virtual time %v", virtual)
+	}
+	if time.Now().Year() == 2000 {
+		t.Error("real clock wasn't restored")
+	}
+}
+
+func TestClockTwice(t *testing.T) {
+	FakeClock(TestingContext(t))
+
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("The code did not panic")
+		}
+	}()
+	FakeClock(TestingContext(t))
+}
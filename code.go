@@ -0,0 +1,26 @@
+package testaroli
+
+import (
+	"context"
+	"unsafe"
+)
+
+/*
+ReplaceCode overwrites machine code at <addr> with <code> until the test, which context is
+passed to ReplaceCode, completes. It is the building block for overriding the code, which isn't
+written in Go, like C functions with [github.com/qrdl/testaroli/cfunc.Override], and the caller
+is responsible for <code> to be valid at <addr>. Go functions should be overridden with [Override].
+*/
+func ReplaceCode(ctx context.Context, addr unsafe.Pointer, code []byte) {
+	t := Testing(ctx)
+	if addr == nil {
+		panic("address cannot be nil")
+	}
+
+	orgCode := make([]byte, len(code))
+	copy(orgCode, unsafe.Slice((*byte)(addr), len(code)))
+	replacePrologue(addr, code) // OS-specific
+	stats.overrides.Add(1)
+
+	t.Cleanup(func() { reset(addr, orgCode) })
+}
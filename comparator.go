@@ -0,0 +1,96 @@
+package testaroli
+
+import (
+	"reflect"
+	"sync"
+	"sync/atomic"
+	"unsafe"
+)
+
+// compares values of the same type, values are always accessible with Interface()
+type comparatorFunc func(a, e reflect.Value) bool
+
+var (
+	// comparator (or nil comparatorFunc, if there is none) for each type, met so far
+	comparators sync.Map
+	// whether any comparator was registered, so types without methods can be skipped
+	comparatorsRegistered atomic.Bool
+)
+
+/*
+RegisterComparator registers function <cmp> to compare values of type T in [Expect.CheckArgs],
+instead of deep comparison, e.g. to compare big structs only by ID:
+
+	func TestMain(m *testing.M) {
+	    RegisterComparator(func(a, e Order) bool { return a.ID == e.ID })
+	    os.Exit(m.Run())
+	}
+
+Comparator is used for values of type T wherever they are - as arguments, or inside slices,
+structs etc., it isn't used for values of other types, which underlying type is T, or for
+pointers to T. If the type has a method Equal(T) bool, like [time.Time], the method is used
+to compare the values, unless other comparator is registered for the type.
+
+Comparators are global for the test binary and may be called concurrently, when large
+slices or maps are compared. RegisterComparator panics, if T is an interface type.
+*/
+func RegisterComparator[T any](cmp func(actual, expected T) bool) {
+	typ := reflect.TypeOf((*T)(nil)).Elem()
+	if typ.Kind() == reflect.Interface {
+		panic("comparator cannot be registered for interface type")
+	}
+
+	comparators.Store(typ, comparatorFunc(func(a, e reflect.Value) bool {
+		return cmp(a.Interface().(T), e.Interface().(T))
+	}))
+	comparatorsRegistered.Store(true)
+}
+
+// comparatorFor returns comparator for the type, or nil if there is none
+func comparatorFor(typ reflect.Type) comparatorFunc {
+	if typ.NumMethod() == 0 && !comparatorsRegistered.Load() {
+		return nil
+	}
+	if cmp, ok := comparators.Load(typ); ok {
+		return cmp.(comparatorFunc)
+	}
+
+	cmp := equalMethod(typ)
+	if cmp, loaded := comparators.LoadOrStore(typ, cmp); loaded {
+		return cmp.(comparatorFunc) // registered concurrently
+	}
+
+	return cmp
+}
+
+// equalMethod returns comparator, calling method Equal(T) bool of type T, if it has one
+func equalMethod(typ reflect.Type) comparatorFunc {
+	m, ok := typ.MethodByName("Equal")
+	if !ok ||
+		m.Type.NumIn() != 2 ||
+		m.Type.In(1) != typ ||
+		m.Type.NumOut() != 1 ||
+		m.Type.Out(0).Kind() != reflect.Bool {
+		return nil
+	}
+
+	return func(a, e reflect.Value) bool {
+		return m.Func.Call([]reflect.Value{a, e})[0].Bool()
+	}
+}
+
+/*
+accessible returns the value, which can be passed to comparator. Values of unexported
+struct fields can't be used with Interface() or Call(), so if value is addressable, it is
+re-created from its address. It returns invalid value if it isn't possible.
+*/
+func accessible(v reflect.Value) reflect.Value {
+	if v.CanInterface() {
+		return v
+	}
+	if v.CanAddr() {
+		return reflect.NewAt(v.Type(), unsafe.Pointer(v.UnsafeAddr())).Elem()
+	}
+
+	return reflect.Value{}
+}
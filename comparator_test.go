@@ -0,0 +1,92 @@
+package testaroli
+
+import (
+	"errors"
+	"reflect"
+	"strings"
+	"testing"
+	"time"
+)
+
+type order struct {
+	ID    int
+	Items []string
+}
+
+type event struct {
+	name string
+	at   time.Time
+}
+
+type celsius float64
+
+func submit(o order) error {
+	if len(o.Items) == 0 {
+		return errors.New("empty order")
+	}
+	return nil
+}
+
+func init() {
+	RegisterComparator(func(a, e order) bool { return a.ID == e.ID })
+	// compare temperatures with 1 degree precision
+	RegisterComparator(func(a, e celsius) bool { return a-e < 1 && e-a < 1 })
+}
+
+func TestEqualMethod(t *testing.T) {
+	now := time.Now()
+	// same instant, without monotonic clock reading and in different location
+	same := now.Round(0).In(time.FixedZone("UTC+1", 3600))
+
+	if res, msg := equal(reflect.ValueOf(now), reflect.ValueOf(same)); !res {
+		t.Errorf("same instants mismatched: %s", msg)
+	}
+	if res, msg := equal(reflect.ValueOf(event{"foo", now}), reflect.ValueOf(event{"foo", same})); !res {
+		t.Errorf("same instants in unexported field mismatched: %s", msg)
+	}
+	res, msg := equal(reflect.ValueOf([]event{{"foo", now}}), reflect.ValueOf([]event{{"foo", now.Add(time.Second)}}))
+	if res || !strings.HasPrefix(msg, "slice elem 0: struct field 'at': actual value") {
+		t.Errorf("unexpected result %v, message '%s'", res, msg)
+	}
+}
+
+func TestRegisteredComparator(t *testing.T) {
+	a := []order{{ID: 1, Items: []string{"foo"}}, {ID: 2}}
+	e := []order{{ID: 1, Items: []string{"bar"}}, {ID: 2, Items: []string{"baz"}}}
+	if res, msg := equal(reflect.ValueOf(a), reflect.ValueOf(e)); !res {
+		t.Errorf("orders with the same ID mismatched: %s", msg)
+	}
+	e[1].ID = 3
+	if res, msg := equal(reflect.ValueOf(a), reflect.ValueOf(e)); res || !strings.HasPrefix(msg, "slice elem 1: actual value") {
+		t.Errorf("unexpected result %v, message '%s'", res, msg)
+	}
+
+	// comparator is used instead of fast path for float slices
+	temps := make([]celsius, parallelCompareThreshold*2)
+	expected := make([]celsius, len(temps))
+	for i := range temps {
+		temps[i], expected[i] = celsius(i%40), celsius(i%40)+0.5
+	}
+	if res, msg := equal(reflect.ValueOf(temps), reflect.ValueOf(expected)); !res {
+		t.Errorf("temperatures within precision mismatched: %s", msg)
+	}
+	expected[len(expected)-1] += 1
+	if res, _ := equal(reflect.ValueOf(temps), reflect.ValueOf(expected)); res {
+		t.Errorf("different temperatures matched")
+	}
+
+	Override(TestingContext(t), submit, Once, func(o order) error {
+		Expectation().CheckArgs(o)
+		return nil
+	})(order{ID: 42})
+
+	testError(t, nil, submit(order{ID: 42, Items: []string{"foo"}}))
+	testError(t, nil, ExpectationsWereMet())
+
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("comparator for interface registered")
+		}
+	}()
+	RegisterComparator(func(a, e error) bool { return true })
+}
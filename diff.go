@@ -0,0 +1,263 @@
+package testaroli
+
+import (
+	"fmt"
+	"reflect"
+	"sort"
+	"strconv"
+	"strings"
+	"unicode/utf8"
+)
+
+/*
+MaxDiffValueLength is the max length of the value, shown in mismatch report, longer values are
+truncated, so reporting the mismatch of huge values takes time and memory, proportional to
+the difference, not to the values. Zero means no limit.
+*/
+var MaxDiffValueLength = 256
+
+/*
+DiffContextElems is the number of array/slice elements, shown in mismatch report on each side of
+the first mismatching element.
+*/
+var DiffContextElems = 3
+
+// maps up to this size are shown with sorted keys, bigger ones - in iteration order
+const maxSortedMapLen = 64
+
+type pathStep struct {
+	kind  string
+	index int
+	name  string
+	key   reflect.Value
+}
+
+/*
+mismatch describes the first difference between actual and expected values. It is
+rendered into the message only when reported, so values are never formatted as a whole.
+*/
+type mismatch struct {
+	path     []pathStep // from innermost to outermost
+	reason   string     // used instead of values when values don't explain the difference
+	actual   reflect.Value
+	expected reflect.Value
+	// innermost array/slice, containing the difference, to show elements around it
+	seqActual   reflect.Value
+	seqExpected reflect.Value
+	seqIndex    int
+}
+
+func (m *mismatch) String() string {
+	var b strings.Builder
+	for i := len(m.path) - 1; i >= 0; i-- {
+		switch s := m.path[i]; {
+		case s.name != "":
+			fmt.Fprintf(&b, "%s '%s': ", s.kind, s.name)
+		case s.key.IsValid():
+			fmt.Fprintf(&b, "%s '%s': ", s.kind, formatValue(s.key))
+		default:
+			fmt.Fprintf(&b, "%s %d: ", s.kind, s.index)
+		}
+	}
+
+	if m.reason != "" {
+		b.WriteString(m.reason)
+	} else {
+		fmt.Fprintf(&b, "actual value '%s' differs from expected '%s'",
+			formatValue(m.actual),
+			formatValue(m.expected))
+	}
+
+	if m.seqActual.IsValid() && m.seqActual.Len() > 1 {
+		fmt.Fprintf(&b, ", around elem %d actual %s, expected %s",
+			m.seqIndex,
+			formatWindow(m.seqActual, m.seqIndex),
+			formatWindow(m.seqExpected, m.seqIndex))
+	}
+
+	return b.String()
+}
+
+// formatValue formats value like %v verb of fmt does, truncating it to MaxDiffValueLength
+func formatValue(v reflect.Value) string {
+	w := &diffWriter{limit: MaxDiffValueLength}
+	writeValue(w, v, 0)
+
+	return w.String()
+}
+
+// formatWindow formats array/slice elements around elem <i>
+func formatWindow(seq reflect.Value, i int) string {
+	lo, hi := max(0, i-DiffContextElems), min(seq.Len(), i+DiffContextElems+1)
+
+	w := &diffWriter{limit: MaxDiffValueLength}
+	w.write("[")
+	if lo > 0 {
+		w.write("... ")
+	}
+	for j := lo; j < hi; j++ {
+		if j > lo {
+			w.write(" ")
+		}
+		writeValue(w, seq.Index(j), 1)
+	}
+	if hi < seq.Len() {
+		w.write(" ...")
+	}
+	w.write("]")
+
+	return w.String()
+}
+
+// diffWriter stops writing after <limit> bytes
+type diffWriter struct {
+	strings.Builder
+	limit int
+	full  bool
+}
+
+func (w *diffWriter) write(s string) {
+	if w.full {
+		return
+	}
+	if room := w.limit - w.Len(); w.limit > 0 && len(s) > room {
+		for room > 0 && !utf8.RuneStart(s[room]) {
+			room-- // don't cut the rune
+		}
+		w.WriteString(s[:room])
+		w.WriteString("...")
+		w.full = true
+		return
+	}
+	w.WriteString(s)
+}
+
+func writeValue(w *diffWriter, v reflect.Value, depth int) {
+	if w.full {
+		return
+	}
+	if !v.IsValid() {
+		w.write("<nil>")
+		return
+	}
+	if v.Kind() == reflect.Pointer && v.IsNil() {
+		w.write("<nil>")
+		return
+	}
+	if s, ok := stringMethod(v); ok {
+		w.write(s)
+		return
+	}
+
+	switch v.Kind() {
+	case reflect.Bool:
+		w.write(strconv.FormatBool(v.Bool()))
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64:
+		w.write(strconv.FormatInt(v.Int(), 10))
+	case reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64, reflect.Uintptr:
+		w.write(strconv.FormatUint(v.Uint(), 10))
+	case reflect.Float32, reflect.Float64:
+		w.write(strconv.FormatFloat(v.Float(), 'g', -1, v.Type().Bits()))
+	case reflect.Complex64, reflect.Complex128:
+		w.write(strconv.FormatComplex(v.Complex(), 'g', -1, v.Type().Bits()))
+	case reflect.String:
+		w.write(v.String())
+	case reflect.Interface:
+		writeValue(w, v.Elem(), depth+1)
+	case reflect.Pointer:
+		// like fmt, show the pointed value only at top level
+		switch v.Elem().Kind() {
+		case reflect.Array, reflect.Slice, reflect.Struct, reflect.Map:
+			if depth == 0 {
+				w.write("&")
+				writeValue(w, v.Elem(), depth+1)
+				return
+			}
+		}
+		w.write("0x" + strconv.FormatUint(uint64(v.Pointer()), 16))
+	case reflect.Chan, reflect.Func, reflect.UnsafePointer:
+		if v.IsNil() {
+			w.write("<nil>")
+		} else {
+			w.write("0x" + strconv.FormatUint(uint64(v.Pointer()), 16))
+		}
+	case reflect.Array, reflect.Slice:
+		w.write("[")
+		for i := 0; i < v.Len() && !w.full; i++ {
+			if i > 0 {
+				w.write(" ")
+			}
+			writeValue(w, v.Index(i), depth+1)
+		}
+		w.write("]")
+	case reflect.Struct:
+		w.write("{")
+		for i := 0; i < v.NumField() && !w.full; i++ {
+			if i > 0 {
+				w.write(" ")
+			}
+			writeValue(w, v.Field(i), depth+1)
+		}
+		w.write("}")
+	case reflect.Map:
+		w.write("map[")
+		writeEntry := func(i int, k, val reflect.Value) {
+			if i > 0 {
+				w.write(" ")
+			}
+			writeValue(w, k, depth+1)
+			w.write(":")
+			writeValue(w, val, depth+1)
+		}
+		if v.Len() <= maxSortedMapLen {
+			keys := v.MapKeys()
+			sort.Slice(keys, func(i, j int) bool { return lessKey(keys[i], keys[j]) })
+			for i, k := range keys {
+				writeEntry(i, k, v.MapIndex(k))
+			}
+		} else {
+			iter := v.MapRange()
+			for i := 0; iter.Next() && !w.full; i++ {
+				writeEntry(i, iter.Key(), iter.Value())
+			}
+		}
+		w.write("]")
+	}
+}
+
+// stringMethod calls Error or String method of the value, if it has one
+func stringMethod(v reflect.Value) (s string, ok bool) {
+	if !v.CanInterface() {
+		return "", false
+	}
+	defer func() {
+		if r := recover(); r != nil {
+			s, ok = fmt.Sprintf("<panic: %v>", r), true
+		}
+	}()
+
+	switch i := v.Interface().(type) {
+	case error:
+		return i.Error(), true
+	case fmt.Stringer:
+		return i.String(), true
+	}
+
+	return "", false
+}
+
+// lessKey orders map keys for formatting
+func lessKey(a, b reflect.Value) bool {
+	switch a.Kind() {
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64:
+		return a.Int() < b.Int()
+	case reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64, reflect.Uintptr:
+		return a.Uint() < b.Uint()
+	case reflect.Float32, reflect.Float64:
+		return a.Float() < b.Float()
+	case reflect.String:
+		return a.String() < b.String()
+	}
+
+	return formatValue(a) < formatValue(b)
+}
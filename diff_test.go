@@ -0,0 +1,130 @@
+package testaroli
+
+import (
+	"errors"
+	"fmt"
+	"reflect"
+	"strings"
+	"testing"
+)
+
+type diffStruct struct {
+	Name  string
+	Elems []int
+	Attrs map[string]int
+}
+
+func TestMismatchReport(t *testing.T) {
+	cases := []struct {
+		name     string
+		actual   any
+		expected any
+		msg      string
+	}{
+		{
+			"scalar", 1, 2,
+			"actual value '1' differs from expected '2'",
+		},
+		{
+			"struct field",
+			diffStruct{Name: "foo"},
+			diffStruct{Name: "bar"},
+			"struct field 'Name': actual value 'foo' differs from expected 'bar'",
+		},
+		{
+			"nested slice",
+			&diffStruct{Elems: []int{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}},
+			&diffStruct{Elems: []int{0, 1, 2, 3, 4, 0, 6, 7, 8, 9}},
+			"struct field 'Elems': slice elem 5: actual value '5' differs from expected '0', " +
+				"around elem 5 actual [... 2 3 4 5 6 7 8 ...], expected [... 2 3 4 0 6 7 8 ...]",
+		},
+		{
+			"array window at the start",
+			[3]string{"a", "b", "c"},
+			[3]string{"x", "b", "c"},
+			"array elem 0: actual value 'a' differs from expected 'x', " +
+				"around elem 0 actual [a b c], expected [x b c]",
+		},
+		{
+			"map value",
+			map[string]int{"foo": 1},
+			map[string]int{"foo": 2},
+			"map value for key 'foo': actual value '1' differs from expected '2'",
+		},
+		{
+			"missing map key",
+			map[string]int{"foo": 1},
+			map[string]int{"bar": 1},
+			"map value for key 'foo': no such key in expected map",
+		},
+		{
+			"slice lengths",
+			[]int{1, 2},
+			[]int{1, 2, 3},
+			"slice lengths differ: actual 2, expected 3",
+		},
+		{
+			"error",
+			errors.New("foo"),
+			errors.New("bar"),
+			"struct field 's': actual value 'foo' differs from expected 'bar'",
+		},
+	}
+
+	for _, c := range cases {
+		res, msg := equal(reflect.ValueOf(c.actual), reflect.ValueOf(c.expected))
+		if res || msg != c.msg {
+			t.Errorf("case '%s': unexpected message '%s'", c.name, msg)
+		}
+	}
+}
+
+func TestMismatchReportHugeValues(t *testing.T) {
+	actual := make([]diffStruct, 200_000)
+	expected := make([]diffStruct, len(actual))
+	for i := range actual {
+		actual[i].Name = strings.Repeat("x", 100)
+		expected[i].Name = actual[i].Name
+	}
+	expected[100_000].Name = "y"
+
+	res, msg := equal(reflect.ValueOf(actual), reflect.ValueOf(expected))
+	if res {
+		t.Fatal("values are equal")
+	}
+	if !strings.HasPrefix(msg, "slice elem 100000: struct field 'Name': actual value 'xxx") {
+		t.Errorf("unexpected message '%s'", msg)
+	}
+	if len(msg) > 5*MaxDiffValueLength {
+		t.Errorf("message isn't truncated, length %d", len(msg))
+	}
+
+	// formatting stops after the limit
+	long := reflect.ValueOf(strings.Repeat("ж", MaxDiffValueLength))
+	if s := formatValue(long); len(s) != MaxDiffValueLength+len("...") {
+		t.Errorf("unexpected length %d of '%s'", len(s), s)
+	}
+	if s := formatValue(reflect.ValueOf(actual)); len(s) > MaxDiffValueLength+len("...") {
+		t.Errorf("unexpected length %d", len(s))
+	}
+}
+
+func TestFormatValue(t *testing.T) {
+	var nilPtr *int
+	values := []any{
+		42, -1.5, float32(0.1), complex64(1 + 2i), true, "foo", nilPtr,
+		[]int{1, 2}, [2]bool{}, struct {
+			a int
+			b string
+		}{1, "x"},
+		map[int]string{3: "c", 1: "a", 2: "b"},
+		&diffStruct{Name: "foo", Elems: []int{1}},
+		errors.New("failure"),
+	}
+
+	for _, v := range values {
+		if s, exp := formatValue(reflect.ValueOf(v)), fmt.Sprintf("%v", v); s != exp {
+			t.Errorf("actual '%s' differs from expected '%s'", s, exp)
+		}
+	}
+}
@@ -3,8 +3,20 @@ package testaroli
 import (
 	"fmt"
 	"reflect"
+	"runtime"
+	"sync"
+	"sync/atomic"
 )
 
+const (
+	// arrays/slices/maps with at least that many elements are compared in parallel
+	parallelCompareThreshold = 1 << 14
+	// how often (in elements) parallel workers check whether they can stop
+	parallelCompareCheck = 256
+)
+
+var parallelCompare atomic.Bool
+
 // standard reflect.Value.Equal has several issues:
 // - it compares pointers only as addresses
 // - it doesn't compare maps
@@ -13,6 +25,26 @@ import (
 // - it panics
 // so I've rolled my own, based on reflect's implementation
 func equal(a, e reflect.Value) (bool, string) {
+	return comparer{}.equal(a, e)
+}
+
+// comparer holds the settings of comparison
+type comparer struct {
+	tol Tolerance
+}
+
+func (c comparer) equal(a, e reflect.Value) (bool, string) {
+	// make the values addressable, so comparators can be used for unexported fields
+	a, e = addressable(a), addressable(e)
+	if m := c.compare(a, e); m != nil {
+		return false, m.String()
+	}
+
+	return true, ""
+}
+
+// compare returns the first difference between actual and expected values, or nil if they are equal
+func (c comparer) compare(a, e reflect.Value) *mismatch {
 	if a.Kind() == reflect.Interface {
 		a = a.Elem()
 	}
@@ -21,112 +53,208 @@ func equal(a, e reflect.Value) (bool, string) {
 	}
 
 	if !a.IsValid() || !e.IsValid() {
-		return a.IsValid() == e.IsValid(), "cannot compare invalid value with valid one"
+		if a.IsValid() == e.IsValid() {
+			return nil
+		}
+		return &mismatch{reason: "cannot compare invalid value with valid one"}
 	}
 
 	if a.Kind() != e.Kind() || a.Type() != e.Type() {
-		return false, fmt.Sprintf("actual type '%s' differs from expected '%s'", a.Type(), e.Type())
+		return &mismatch{reason: fmt.Sprintf("actual type '%s' differs from expected '%s'", a.Type(), e.Type())}
+	}
+
+	if cmp := comparatorFor(a.Type()); cmp != nil {
+		if aa, ea := accessible(a), accessible(e); aa.IsValid() && ea.IsValid() {
+			if cmp(aa, ea) {
+				return nil
+			}
+			return &mismatch{actual: a, expected: e}
+		}
 	}
 
+	var res bool
 	switch a.Kind() {
 	case reflect.Bool:
-		return a.Bool() == e.Bool(), ""
+		res = a.Bool() == e.Bool()
 	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64:
-		return a.Int() == e.Int(), ""
+		res = a.Int() == e.Int()
 	case reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64, reflect.Uintptr:
-		return a.Uint() == e.Uint(), ""
+		res = a.Uint() == e.Uint()
 	case reflect.Float32, reflect.Float64:
-		return a.Float() == e.Float(), ""
+		res = c.tol.floatEqual(a.Float(), e.Float(), a.Type().Bits())
 	case reflect.Complex64, reflect.Complex128:
-		return a.Complex() == e.Complex(), ""
+		bits := a.Type().Bits() / 2
+		res = c.tol.floatEqual(real(a.Complex()), real(e.Complex()), bits) &&
+			c.tol.floatEqual(imag(a.Complex()), imag(e.Complex()), bits)
 	case reflect.String:
-		return a.String() == e.String(), ""
+		res = a.String() == e.String()
 	case reflect.Chan:
-		return a.Pointer() == e.Pointer(), ""
+		res = a.Pointer() == e.Pointer()
 	case reflect.Pointer, reflect.UnsafePointer:
 		if a.Pointer() == e.Pointer() {
-			return true, ""
-		}
-		res, str := equal(reflect.Indirect(a), reflect.Indirect(e))
-		if !res && str == "" {
-			str = fmt.Sprintf("actual value '%v' differs from expected '%v'", reflect.Indirect(a), reflect.Indirect(e))
+			return nil
 		}
-		return res, str
+		return c.compare(reflect.Indirect(a), reflect.Indirect(e))
 	case reflect.Array:
 		// u and v have the same type so they have the same length
-		vl := a.Len()
-		if vl == 0 {
-			return true, ""
-		}
-		for i := 0; i < vl; i++ {
-			res, str := equal(a.Index(i), e.Index(i))
-			if !res {
-				if str == "" {
-					str = fmt.Sprintf("actual value '%v' differs from expected '%v'",
-						a.Index(i), e.Index(i))
-				}
-				return false, fmt.Sprintf("array elem %d: %s", i, str)
-			}
-		}
-		return true, ""
+		return c.compareElems(a, e, a.Len(), "array elem")
 	case reflect.Struct:
 		// u and v have the same type so they have the same fields
 		nf := a.NumField()
 		for i := 0; i < nf; i++ {
-			res, str := equal(a.Field(i), e.Field(i))
-			if !res {
-				if str == "" {
-					str = fmt.Sprintf("actual value '%v' differs from expected '%v'",
-						a.Field(i), e.Field(i))
-				}
-				return false, fmt.Sprintf("struct field '%s': %s", a.Type().Field(i).Name, str)
+			if m := c.compare(a.Field(i), e.Field(i)); m != nil {
+				m.path = append(m.path, pathStep{kind: "struct field", name: a.Type().Field(i).Name})
+				return m
 			}
 		}
-		return true, ""
+		return nil
 	case reflect.Map:
 		if a.Pointer() == e.Pointer() {
-			return true, ""
+			return nil
 		}
-		keys := a.MapKeys()
-		if len(keys) != len(e.MapKeys()) {
-			return false, "map lengths differ"
+		if a.Len() != e.Len() {
+			return &mismatch{reason: fmt.Sprintf("map lengths differ: actual %d, expected %d", a.Len(), e.Len())}
 		}
-		for _, k := range keys {
-			res, str := equal(a.MapIndex(k), e.MapIndex(k))
-			if !res {
-				if str == "" {
-					str = fmt.Sprintf("actual value '%v' differs from expected '%v'",
-						a.MapIndex(k), e.MapIndex(k))
-				}
-				return false, fmt.Sprintf("map value for key '%v': %s", k, str)
+		if a.Len() >= parallelCompareThreshold {
+			keys := a.MapKeys()
+			if m, ok := compareParallel(len(keys), func(i int) *mismatch { return c.compareMapValue(a, e, keys[i]) }); ok {
+				return m
 			}
 		}
-		return true, ""
+		iter := a.MapRange()
+		for iter.Next() {
+			if m := c.compareMapValue(a, e, iter.Key()); m != nil {
+				return m
+			}
+		}
+		return nil
 	case reflect.Func:
-		return a.Pointer() == e.Pointer(), ""
 		// function can be equal only to itself
+		res = a.Pointer() == e.Pointer()
 	case reflect.Slice:
-		if a.Pointer() == e.Pointer() {
-			return true, ""
+		if a.Pointer() == e.Pointer() && a.Len() == e.Len() {
+			return nil
 		}
-		vl := a.Len()
-		if vl != e.Len() {
-			return false, "slice lengths differ"
+		if a.Len() != e.Len() {
+			return &mismatch{reason: fmt.Sprintf("slice lengths differ: actual %d, expected %d", a.Len(), e.Len())}
 		}
-		if vl == 0 {
-			return true, ""
+		return c.compareElems(a, e, a.Len(), "slice elem")
+	default:
+		return &mismatch{reason: "invalid variable Kind"} // should never happen
+	}
+
+	if res {
+		return nil
+	}
+	return &mismatch{actual: a, expected: e}
+}
+
+// addressable returns addressable copy of the struct or array value, so its fields/elements are addressable too
+func addressable(v reflect.Value) reflect.Value {
+	if !v.IsValid() || v.CanAddr() || (v.Kind() != reflect.Struct && v.Kind() != reflect.Array) {
+		return v
+	}
+	c := reflect.New(v.Type()).Elem()
+	c.Set(v)
+
+	return c
+}
+
+// compareElems compares first <n> elements of arrays/slices <a> and <e>
+func (c comparer) compareElems(a, e reflect.Value, n int, kind string) *mismatch {
+	cmp := func(i int) *mismatch {
+		m := c.compare(a.Index(i), e.Index(i))
+		if m != nil {
+			m.path = append(m.path, pathStep{kind: kind, index: i})
+			if !m.seqActual.IsValid() {
+				m.seqActual, m.seqExpected, m.seqIndex = a, e, i
+			}
 		}
-		for i := 0; i < vl; i++ {
-			res, str := equal(a.Index(i), e.Index(i))
-			if !res {
-				if str == "" {
-					str = fmt.Sprintf("actual value '%v' differs from expected '%v'",
-						a.Index(i), e.Index(i))
+		return m
+	}
+
+	if i, ok := c.firstFloatMismatch(a, e, n); ok {
+		if i < 0 {
+			return nil
+		}
+		return cmp(i)
+	}
+	if n >= parallelCompareThreshold {
+		if m, ok := compareParallel(n, cmp); ok {
+			return m
+		}
+	}
+	for i := 0; i < n; i++ {
+		if m := cmp(i); m != nil {
+			return m
+		}
+	}
+
+	return nil
+}
+
+// compareMapValue compares values for key <k> of maps <a> and <e>
+func (c comparer) compareMapValue(a, e, k reflect.Value) *mismatch {
+	ev := e.MapIndex(k)
+	var m *mismatch
+	if !ev.IsValid() {
+		m = &mismatch{reason: "no such key in expected map"}
+	} else {
+		m = c.compare(a.MapIndex(k), ev)
+	}
+	if m != nil {
+		m.path = append(m.path, pathStep{kind: "map value for key", key: k})
+	}
+
+	return m
+}
+
+/*
+compareParallel splits <n> elements into contiguous ranges, one per CPU, and compares
+them with <cmp> concurrently. Result is the mismatch with the lowest index, the same as
+sequential comparison finds, workers stop as soon as lower mismatch is found by other
+worker. Only one parallel comparison runs at a time, so it returns false, if another
+one (e.g. for outer collection) is in progress, or if there is only one CPU.
+*/
+func compareParallel(n int, cmp func(i int) *mismatch) (*mismatch, bool) {
+	workers := runtime.GOMAXPROCS(0)
+	if workers < 2 || !parallelCompare.CompareAndSwap(false, true) {
+		return nil, false
+	}
+	defer parallelCompare.Store(false)
+
+	chunk := (n + workers - 1) / workers
+	results := make([]*mismatch, workers)
+	var lowest atomic.Int64
+	lowest.Store(int64(n))
+
+	var wg sync.WaitGroup
+	for w := 0; w*chunk < n; w++ {
+		wg.Add(1)
+		go func(w, from, to int) {
+			defer wg.Done()
+			for i := from; i < to; i++ {
+				if i%parallelCompareCheck == 0 && int64(i) > lowest.Load() {
+					return // mismatch with lower index is already found
+				}
+				if m := cmp(i); m != nil {
+					results[w] = m
+					for cur := lowest.Load(); int64(i) < cur && !lowest.CompareAndSwap(cur, int64(i)); {
+						cur = lowest.Load()
+					}
+					return
 				}
-				return false, fmt.Sprintf("slice elem %d: %s", i, str)
 			}
+		}(w, w*chunk, min(n, (w+1)*chunk))
+	}
+	wg.Wait()
+
+	// worker stops only if some lower range has a mismatch, so the first found is the lowest
+	for _, m := range results {
+		if m != nil {
+			return m, true
 		}
-		return true, ""
 	}
-	return false, "invalid variable Kind" // should never happen
+
+	return nil, true
 }
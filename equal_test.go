@@ -2,7 +2,10 @@ package testaroli
 
 import (
 	"errors"
+	"fmt"
 	"reflect"
+	"runtime"
+	"strings"
 	"testing"
 )
 
@@ -278,3 +281,39 @@ func TestCompositeTypes(t *testing.T) {
 		}
 	}
 }
+
+func TestParallelEqual(t *testing.T) {
+	defer runtime.GOMAXPROCS(runtime.GOMAXPROCS(8))
+
+	const size = parallelCompareThreshold * 10
+	actual := make([]int, size)
+	expected := make([]int, size)
+	for i := range actual {
+		actual[i], expected[i] = i, i
+	}
+	if res, msg := equal(reflect.ValueOf(actual), reflect.ValueOf(expected)); !res {
+		t.Errorf("equal slices mismatched: %s", msg)
+	}
+
+	// lowest index is reported, regardless of which worker finds its mismatch first
+	for _, i := range []int{size - 1, size / 2, parallelCompareThreshold + 1, 3} {
+		expected[i] = -1
+		_, msg := equal(reflect.ValueOf(actual), reflect.ValueOf(expected))
+		if !strings.HasPrefix(msg, fmt.Sprintf("slice elem %d:", i)) {
+			t.Errorf("unexpected message '%s'", msg)
+		}
+	}
+
+	actualMap := make(map[int]int, size)
+	expectedMap := make(map[int]int, size)
+	for i := 0; i < size; i++ {
+		actualMap[i], expectedMap[i] = i, i
+	}
+	if res, msg := equal(reflect.ValueOf(actualMap), reflect.ValueOf(expectedMap)); !res {
+		t.Errorf("equal maps mismatched: %s", msg)
+	}
+	expectedMap[size/3] = -1
+	if _, msg := equal(reflect.ValueOf(actualMap), reflect.ValueOf(expectedMap)); !strings.HasPrefix(msg, fmt.Sprintf("map value for key '%d':", size/3)) {
+		t.Errorf("unexpected message '%s'", msg)
+	}
+}
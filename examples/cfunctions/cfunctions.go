@@ -0,0 +1,46 @@
+package main
+
+/*
+#cgo LDFLAGS: -rdynamic
+#include <stddef.h>
+
+// checksum stands for the call of expensive native library
+__attribute__((noinline)) unsigned int checksum(const char *data, size_t len) {
+    unsigned int sum = 0;
+    for (int round = 0; round < 100000; round++) {
+        for (size_t i = 0; i < len; i++) {
+            sum = sum * 31 + (unsigned char)data[i];
+        }
+    }
+    return sum;
+}
+*/
+import "C"
+
+import (
+	"errors"
+	"fmt"
+	"unsafe"
+)
+
+var ErrCorrupted = errors.New("data is corrupted")
+
+func main() {
+	data := []byte("some data")
+	if err := verify(data, sign(data)); err != nil {
+		fmt.Printf("Verification failed: %v", err)
+	} else {
+		fmt.Println("Verification successful")
+	}
+}
+
+func sign(data []byte) uint32 {
+	return uint32(C.checksum((*C.char)(unsafe.Pointer(&data[0])), C.size_t(len(data))))
+}
+
+func verify(data []byte, signature uint32) error {
+	if sign(data) != signature {
+		return ErrCorrupted
+	}
+	return nil
+}
@@ -0,0 +1,21 @@
+//go:build cgo && linux && amd64
+
+package main
+
+import (
+	"testing"
+
+	. "github.com/qrdl/testaroli"
+	"github.com/qrdl/testaroli/cfunc"
+)
+
+func TestVerify(t *testing.T) {
+	cfunc.Override(TestingContext(t), "checksum", checksumStubPtr)
+
+	if err := verify([]byte("some data"), 42); err != nil {
+		t.Errorf("unexpected %v", err)
+	}
+	if err := verify([]byte("other data"), 43); err != ErrCorrupted {
+		t.Errorf("unexpected %v", err)
+	}
+}
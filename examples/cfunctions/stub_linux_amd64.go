@@ -0,0 +1,16 @@
+//go:build cgo
+
+package main
+
+// extern unsigned int checksumStub(char *, size_t);
+import "C"
+
+import "unsafe"
+
+// pointer to C entry of checksumStub, to be used with cfunc.Override
+var checksumStubPtr = unsafe.Pointer(C.checksumStub)
+
+//export checksumStub
+func checksumStub(data *C.char, len C.size_t) C.uint {
+	return 42
+}
@@ -5,6 +5,7 @@ import (
 	"fmt"
 	"reflect"
 	"runtime"
+	"sync/atomic"
 	"testing"
 	"unsafe"
 )
@@ -15,12 +16,15 @@ Expect holds information about overridden function and has methods to set and ch
 type Expect struct {
 	ctx         context.Context
 	expCount    int
-	actCount    int
+	actCount    int64 // accessed atomically
 	mockAddr    unsafe.Pointer
 	orgAddr     unsafe.Pointer
 	args        []reflect.Value
 	orgName     string
 	orgPrologue []byte
+	wrapper     any // mock wrapper, set when mock is tagged with pprof labels
+	tolerance   Tolerance
+	group       *expectGroup
 }
 
 /*
@@ -32,39 +36,111 @@ arguments, because Expectation checks that function was called in order, and if
 call for overridden function, it restores the original state and overrides next function in the chain.
 */
 func Expectation() *Expect {
-	pc, _, _, ok := runtime.Caller(1)
-	if !ok {
+	// runtime.Callers is cheaper than runtime.Caller, as it doesn't resolve file and line
+	var pc [1]uintptr
+	if runtime.Callers(2, pc[:]) == 0 {
 		panic("cannot identify calling function")
 	}
-	entry := runtime.FuncForPC(pc).Entry()
+	entry := runtime.FuncForPC(pc[0] - 1).Entry()
+
+	chainMu.RLock()
+	e := effective(entry)
+	var call *Expect
+	if e != nil {
+		run := atomic.AddInt64(&e.actCount, 1)
+		countCall(e.orgAddr)
+		// copy, so the run number and values, set with Expect, belong to this call; it is
+		// copied under the lock, as slot of expectation is reused when it leaves the chain
+		call = &Expect{
+			ctx:       e.ctx,
+			expCount:  e.expCount,
+			actCount:  run,
+			mockAddr:  e.mockAddr,
+			orgAddr:   e.orgAddr,
+			args:      e.args,
+			orgName:   e.orgName,
+			tolerance: e.tolerance,
+		}
+	}
+	var headCtx context.Context
+	var headName string
+	head := expectations.front()
+	if head != nil {
+		headCtx, headName = head.ctx, head.orgName
+	}
+	chainMu.RUnlock()
 
-	if len(expectations) == 0 {
+	if head == nil {
 		panic("unexpected function call")
 	}
 
-	e := expectations[0]
-	t := e.Testing()
-	t.Helper()
-
 	// make sure we have called expected function
-	if uintptr(e.mockAddr) != entry {
-		t.Errorf("unexpected function call (expected %s)", e.orgName) // should never happen
+	if call == nil || (call.actCount > int64(call.expCount) && call.expCount != Unlimited) {
+		t := Testing(headCtx)
+		t.Helper()
+		t.Errorf("unexpected function call (expected %s)", headName) // should never happen
 		return &Expect{}
 	}
 
-	e.actCount++
-	if e.actCount == e.expCount && e.expCount != Unlimited {
-		reset(e.orgAddr, e.orgPrologue)
-		expectations = expectations[1:] // remove from expected chain
-		if len(expectations) > 0 {
-			// override next expected function
-			expectations[0].orgPrologue = override( // call arch-specific function
-				expectations[0].orgAddr,
-				expectations[0].mockAddr)
+	if call.actCount == int64(call.expCount) {
+		chainMu.Lock()
+		// chain can be cleared meanwhile, e.g. when test completes
+		if effective(entry) == e {
+			e.complete()
 		}
+		chainMu.Unlock()
 	}
 
-	return e
+	return call
+}
+
+// met reports whether the expectation is met and its function is restored
+func (e *Expect) met() bool {
+	return e.expCount != Unlimited && atomic.LoadInt64(&e.actCount) >= int64(e.expCount)
+}
+
+/*
+complete restores the original function and, if it was the last effective expectation,
+removes effective expectations from the chain and makes next ones effective. Must be
+called with chainMu locked.
+*/
+func (e *Expect) complete() {
+	if e.group != nil {
+		if e.group.remaining--; e.group.remaining > 0 {
+			reset(e.orgAddr, e.orgPrologue)
+			return // not all expectations in the group are met
+		}
+	}
+
+	// expectation is cleared, when chain becomes empty
+	orgAddr, orgPrologue, wrapped := e.orgAddr, e.orgPrologue, e.wrapper != nil
+	for n := headSize(); n > 0; n-- {
+		expectations.pop() // remove from expected chain
+	}
+
+	// if the same function is overridden next, like in table-driven tests, it is enough
+	// to change the jump target, or to do nothing, if mock is the same (jumps to the wrappers
+	// are longer, so original prologue is saved only for the jump of the same kind)
+	var reoverride *Expect
+	for i := 0; i < headSize(); i++ {
+		if next := expectations.at(i); next.orgAddr == orgAddr && (next.wrapper != nil) == wrapped {
+			reoverride = next
+		}
+	}
+	if reoverride != nil {
+		reoverride.install()
+		reoverride.orgPrologue = orgPrologue
+	} else {
+		reset(orgAddr, orgPrologue)
+	}
+
+	for i := 0; i < headSize(); i++ {
+		// override next expected function(s)
+		if next := expectations.at(i); next != reoverride {
+			next.orgPrologue = next.install()
+		}
+	}
+	chainAdvanced()
 }
 
 /*
@@ -86,7 +162,7 @@ example:
 	})
 */
 func (e Expect) RunNumber() int {
-	return e.actCount - 1
+	return int(e.actCount) - 1
 }
 
 /*
@@ -111,17 +187,21 @@ numbering - for array/slice elements, function arguments and run numbers, e.g. f
 call (if function was overridden for several calls) is called `run 0`
 */
 func (e Expect) CheckArgs(args ...any) {
+	// t.Helper() is expensive, so it is called only when there is something to report
+	if msg := e.checkArgs(args); msg != "" {
+		t := e.Testing()
+		t.Helper()
+		t.Error(msg)
+	}
+}
 
-	t := e.Testing()
-	t.Helper()
-
+// checkArgs returns the description of the first mismatch, or empty string if all args match
+func (e Expect) checkArgs(args []any) string {
 	if len(args) != len(e.args) {
 		if len(e.args) == 0 {
-			t.Errorf("no extected args set")
-		} else {
-			t.Errorf("actual arg count %d doesn't match expected %d", len(args), len(e.args))
+			return "no extected args set"
 		}
-		return
+		return fmt.Sprintf("actual arg count %d doesn't match expected %d", len(args), len(e.args))
 	}
 
 	for i, a := range args {
@@ -131,38 +211,30 @@ func (e Expect) CheckArgs(args ...any) {
 			// no risk in calling IsNil here since we already established that type is nilable
 			if !expectedArg.IsNil() {
 				if e.expCount > 1 || e.expCount == Unlimited {
-					t.Errorf(
+					return fmt.Sprintf(
 						"arg %d on the run %d actual value is nil while non-nil is expected",
 						i,
 						e.actCount-1) // 0-based
-					return
-				} else {
-					t.Errorf(
-						"arg %d actual value is nil while non-nil is expected",
-						i)
-					return
 				}
+				return fmt.Sprintf(
+					"arg %d actual value is nil while non-nil is expected",
+					i)
 			}
 			continue
 		}
-		res, msg := equal(actualArg, expectedArg)
+		res, msg := comparer{tol: e.tolerance}.equal(actualArg, expectedArg)
 		if !res {
-			if msg == "" {
-				msg = fmt.Sprintf("actual value '%v' differs from expected '%v'",
-					actualArg,
-					expectedArg)
-			}
 			if e.expCount > 1 || e.expCount == Unlimited {
-				t.Errorf("arg %d on the run %d: %s",
+				return fmt.Sprintf("arg %d on the run %d: %s",
 					i+1,
 					e.actCount-1, // 0-based
 					msg)
-			} else {
-				t.Errorf("arg %d: %s", i, msg)
 			}
-			return
+			return fmt.Sprintf("arg %d: %s", i, msg)
 		}
 	}
+
+	return ""
 }
 
 /*
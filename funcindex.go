@@ -0,0 +1,197 @@
+package testaroli
+
+import (
+	"context"
+	"fmt"
+	"reflect"
+	"runtime"
+	"sync"
+	"sync/atomic"
+	"unsafe"
+)
+
+type funcIndex struct {
+	byName  map[string]uintptr
+	byEntry map[uintptr]string
+}
+
+var (
+	funcIndexOnce  sync.Once
+	funcIndexBuilt atomic.Pointer[funcIndex]
+)
+
+/*
+OverrideByName works like [Override], but the function to override is specified by its
+fully-qualified name, as reported by [runtime.FuncForPC], so it is possible to override
+unexported functions and methods from other packages:
+
+	OverrideByName(ctx, "net/http.(*Transport).roundTrip", Once, func(t *http.Transport, req *http.Request) (*http.Response, error) {
+	    Expectation()
+	    return nil, ErrNoConnection
+	})
+
+Unlike with [Override], the compiler cannot check that mock has the same signature as overridden
+function, calling the function with wrong mock signature leads to undefined behaviour.
+OverrideByName panics if there is no function with given name in the binary, e.g. when
+it isn't used, so it was removed by linker.
+
+The index of function names is built on the first call of OverrideByName from runtime's
+function table, and it takes time, proportional to the number of functions in the binary.
+*/
+func OverrideByName[T any](ctx context.Context, name string, count int, mock T) T {
+	if reflect.ValueOf(mock).Kind() != reflect.Func {
+		panic("OverrideByName() can be called only for function/method")
+	}
+	entry, ok := functions().byName[name]
+	if !ok {
+		panic(fmt.Sprintf("function %s not found", name))
+	}
+
+	// function value is a pointer to the closure object, which starts with the code pointer
+	var org T
+	*(*unsafe.Pointer)(unsafe.Pointer(&org)) = unsafe.Pointer(&entry)
+
+	return Override(ctx, org, count, mock)
+}
+
+// functions returns index of all functions in the binary, building it on the first call
+func functions() *funcIndex {
+	funcIndexOnce.Do(func() {
+		funcIndexBuilt.Store(buildFuncIndex())
+	})
+
+	return funcIndexBuilt.Load()
+}
+
+// funcName returns the name of the function, starting at <entry>
+func funcName(entry unsafe.Pointer) string {
+	// don't build the index just for that, runtime's lookup is cheap enough
+	if idx := funcIndexBuilt.Load(); idx != nil {
+		if name, ok := idx.byEntry[uintptr(entry)]; ok {
+			return name
+		}
+	}
+
+	return runtime.FuncForPC(uintptr(entry)).Name()
+}
+
+// moduledata mirrors the start of runtime's moduledata, which layout is the same since Go 1.18
+type moduledata struct {
+	pcHeader     unsafe.Pointer
+	funcnametab  []byte
+	cutab        []uint32
+	filetab      []byte
+	pctab        []byte
+	pclntable    []byte
+	ftab         []functab
+	findfunctab  uintptr
+	minpc, maxpc uintptr
+	text, etext  uintptr
+}
+
+type functab struct {
+	entryoff uint32 // relative to text
+	funcoff  uint32
+}
+
+//go:linkname firstmoduledata runtime.firstmoduledata
+var firstmoduledata moduledata
+
+/*
+buildFuncIndex lists the functions from runtime's function table of the binary. If the table
+doesn't look valid, e.g. because its layout was changed, it walks the whole text of the binary
+instead.
+*/
+func buildFuncIndex() *funcIndex {
+	idx := &funcIndex{byName: map[string]uintptr{}, byEntry: map[uintptr]string{}}
+	add := func(entry uintptr, f *runtime.Func) {
+		if _, ok := idx.byName[f.Name()]; !ok {
+			idx.byName[f.Name()] = entry
+		}
+		idx.byEntry[entry] = f.Name()
+	}
+
+	md := &firstmoduledata
+	known := reflect.ValueOf(buildFuncIndex).Pointer()
+	if len(md.ftab) == 0 || md.text != md.minpc || known < md.text || known >= md.etext {
+		walkFuncs(add)
+		return idx
+	}
+	// the last entry of the table marks the end of the text
+	for _, ft := range md.ftab[:len(md.ftab)-1] {
+		entry := md.text + uintptr(ft.entryoff)
+		// entries are offsets in the text, which can be split into sections
+		if f := runtime.FuncForPC(entry); f != nil && f.Entry() == entry {
+			add(entry, f)
+		}
+	}
+
+	return idx
+}
+
+/*
+walkFuncs walks the whole text of the binary, using runtime's function table - starting
+from any known function it finds the boundaries of the neighbour functions with exponential,
+followed by binary, search, so the number of lookups is logarithmic to the function size.
+*/
+func walkFuncs(add func(entry uintptr, f *runtime.Func)) {
+	entryAt := func(pc uintptr) uintptr {
+		if f := runtime.FuncForPC(pc); f != nil {
+			return f.Entry()
+		}
+		return 0
+	}
+
+	// find the start of the text - the lowest PC, which belongs to any function
+	known := reflect.ValueOf(walkFuncs).Pointer()
+	start := firstPC(known, func(pc uintptr) bool { return entryAt(pc) == 0 }, false)
+
+	for entry := start; entry != 0; {
+		add(entry, runtime.FuncForPC(entry))
+		end := firstPC(entry, func(pc uintptr) bool { return entryAt(pc) != entry }, true)
+		entry = entryAt(end)
+	}
+}
+
+/*
+firstPC finds the boundary, closest to <from> in given direction, where <differs> becomes true.
+Moving forward it returns the first PC, for which <differs> is true, moving backward it returns
+the last PC, for which <differs> is false. <differs> must be false for <from> and monotonic
+in given direction.
+*/
+func firstPC(from uintptr, differs func(uintptr) bool, forward bool) uintptr {
+	// exponential search for any PC, for which <differs> is true
+	same, step := from, uintptr(16)
+	var diff uintptr
+	for {
+		if forward {
+			diff = same + step
+		} else if same >= step {
+			diff = same - step
+		} else {
+			diff = 0
+		}
+		if differs(diff) {
+			break
+		}
+		if diff == 0 {
+			return 0
+		}
+		same, step = diff, step*2
+	}
+
+	// binary search for the boundary between <same> and <diff>
+	for same+1 != diff && diff+1 != same {
+		mid := same/2 + diff/2 + same&diff&1
+		if differs(mid) {
+			diff = mid
+		} else {
+			same = mid
+		}
+	}
+	if forward {
+		return diff
+	}
+
+	return same
+}
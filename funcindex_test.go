@@ -0,0 +1,84 @@
+package testaroli
+
+import (
+	"reflect"
+	"runtime"
+	"strings"
+	"testing"
+)
+
+func TestFuncIndex(t *testing.T) {
+	idx := functions()
+
+	for name, fn := range map[string]any{
+		"github.com/qrdl/testaroli.foo":                 foo,
+		"github.com/qrdl/testaroli.(*Expect).CheckArgs": (*Expect).CheckArgs,
+		"strings.Split": strings.Split,
+	} {
+		if idx.byName[name] != reflect.ValueOf(fn).Pointer() {
+			t.Errorf("function %s not found in index", name)
+		}
+	}
+	if len(idx.byName) < 1000 {
+		t.Errorf("too few functions in index: %d", len(idx.byName))
+	}
+}
+
+func TestFuncIndexTextEnd(t *testing.T) {
+	idx := functions()
+
+	// generated main of the test binary is linked last
+	if _, ok := idx.byName["main.main"]; !ok {
+		t.Error("main.main not found in index")
+	}
+	last := runtime.FuncForPC(firstmoduledata.etext - 1)
+	if idx.byEntry[last.Entry()] != last.Name() {
+		t.Errorf("last function %s not found in index", last.Name())
+	}
+}
+
+func TestFuncIndexWalk(t *testing.T) {
+	walked := map[uintptr]string{}
+	walkFuncs(func(entry uintptr, f *runtime.Func) { walked[entry] = f.Name() })
+
+	if !reflect.DeepEqual(walked, functions().byEntry) {
+		t.Errorf("walking found %d functions, function table has %d", len(walked), len(functions().byEntry))
+	}
+}
+
+func TestOverrideByName(t *testing.T) {
+	OverrideByName(TestingContext(t), "github.com/qrdl/testaroli.bar", Once, func(i int) error {
+		Expectation().CheckArgs(i)
+		return nil
+	})(2)
+
+	err := foo(1)
+
+	testError(t, nil, err)
+	testError(t, nil, ExpectationsWereMet())
+}
+
+func TestOverrideByNameUnexported(t *testing.T) {
+	// strings.Split(s, "") calls unexported strings.explode()
+	OverrideByName(TestingContext(t), "strings.explode", Once, func(s string, n int) []string {
+		Expectation().CheckArgs(s, n)
+		return []string{"foo"}
+	})("bar", -1)
+
+	res := strings.Split("bar", "")
+
+	if len(res) != 1 || res[0] != "foo" {
+		t.Errorf("unexpected result %v", res)
+	}
+	testError(t, nil, ExpectationsWereMet())
+}
+
+func TestOverrideByNameUnknown(t *testing.T) {
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("The code did not panic")
+		}
+	}()
+
+	OverrideByName(TestingContext(t), "github.com/qrdl/testaroli.nosuchfunc", Once, func() {})
+}
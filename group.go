@@ -0,0 +1,119 @@
+package testaroli
+
+import (
+	"context"
+	"fmt"
+	"unsafe"
+)
+
+// expectGroup joins adjacent expectations of the chain, which can be met in any order
+type expectGroup struct {
+	size      int // number of expectations in the group
+	remaining int // number of expectations, which aren't met yet
+	orgs      map[unsafe.Pointer]bool
+	mocks     map[unsafe.Pointer]bool // mocks are unique in the group, effective() finds expectation by mock
+}
+
+// group, to which overrides are currently added by Group, protected by chainMu
+var currentGroup *expectGroup
+
+/*
+Group places all overrides, made by <overrides>, into one group, so overridden functions
+can be called in any order. Group becomes effective as a whole - all its overrides are
+applied at once - when previous override in the chain is completed, and next override
+becomes effective only when all overrides in the group are completed. It allows to test
+the code, which calls functions concurrently, like worker pools:
+
+	// fetch() and parse() are called by workers in any order, then results are stored
+	Group(ctx, func() {
+	    Override(ctx, fetch, 10, func(url string) ([]byte, error) {
+	        Expectation()
+	        return []byte("foo"), nil
+	    })
+	    Override(ctx, parse, 10, func(data []byte) (Item, error) {
+	        Expectation()
+	        return Item{}, nil
+	    })
+	})
+	Override(ctx, store, Once, func(items []Item) error {
+	    Expectation()
+	    return nil
+	})
+
+Functions, overridden in the group, and their mocks must be different, and their count can't be [Unlimited].
+Groups can't be nested. Calls of overridden functions in the group don't block each other,
+the lock is taken only when override is completed.
+*/
+func Group(ctx context.Context, overrides func()) {
+	Testing(ctx) // just to make sure the context is correct
+
+	chainMu.Lock()
+	if currentGroup != nil {
+		chainMu.Unlock()
+		panic("Group() cannot be nested")
+	}
+	currentGroup = &expectGroup{orgs: map[unsafe.Pointer]bool{}, mocks: map[unsafe.Pointer]bool{}}
+	chainMu.Unlock()
+
+	defer func() {
+		chainMu.Lock()
+		currentGroup = nil
+		chainMu.Unlock()
+	}()
+
+	overrides()
+}
+
+// checkGroup panics if expectation can't be added to the group, which is being built, must be
+// called with chainMu locked before expectation is pushed to the chain
+func checkGroup(e Expect) {
+	if currentGroup == nil {
+		return
+	}
+	if e.expCount == Unlimited {
+		panic("Unlimited count cannot be used in Group()")
+	}
+	if currentGroup.orgs[e.orgAddr] {
+		panic(fmt.Sprintf("function %s is already overridden in this group", e.orgName))
+	}
+	if currentGroup.mocks[e.mockAddr] {
+		panic(fmt.Sprintf("mock for %s is already used by another override in this group", e.orgName))
+	}
+}
+
+// addToGroup adds expectation, checked by checkGroup, to the group, which is being built, must be
+// called with chainMu locked
+func addToGroup(e *Expect) {
+	if currentGroup == nil {
+		return
+	}
+	currentGroup.orgs[e.orgAddr] = true
+	currentGroup.mocks[e.mockAddr] = true
+	currentGroup.size++
+	currentGroup.remaining++
+	e.group = currentGroup
+}
+
+// headSize returns the number of expectations at the head of the chain, which are effective
+func headSize() int {
+	e := expectations.front()
+	if e == nil {
+		return 0
+	}
+	if e.group == nil {
+		return 1
+	}
+
+	return e.group.size
+}
+
+// effective returns effective expectation for the mock, or nil if mock isn't effective
+func effective(mockAddr uintptr) *Expect {
+	for i := 0; i < headSize(); i++ {
+		if e := expectations.at(i); uintptr(e.mockAddr) == mockAddr {
+			return e
+		}
+	}
+
+	return nil
+}
@@ -0,0 +1,170 @@
+package testaroli
+
+import (
+	"context"
+	"errors"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+)
+
+var errTest = errors.New("test")
+
+func TestGroup(t *testing.T) {
+	ctx := TestingContext(t)
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation().CheckArgs(i)
+		return nil
+	})(1)
+	Group(ctx, func() {
+		Override(ctx, baz, 50, func(i int) error {
+			Expectation()
+			return nil
+		})
+		Override(ctx, qux, 50, func(err error) error {
+			Expectation()
+			return err
+		})
+	})
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation().CheckArgs(i)
+		return nil
+	})(2)
+
+	// group isn't effective yet
+	testError(t, errTest, qux(errTest))
+	testError(t, nil, bar(1))
+
+	var wg sync.WaitGroup
+	for i := 0; i < 50; i++ {
+		wg.Add(2)
+		go func(i int) {
+			defer wg.Done()
+			testError(t, nil, baz(i))
+		}(i)
+		go func() {
+			defer wg.Done()
+			testError(t, nil, qux(nil))
+		}()
+	}
+	wg.Wait()
+
+	testError(t, nil, bar(2))
+	testError(t, nil, ExpectationsWereMet())
+}
+
+func TestGroupAtHead(t *testing.T) {
+	ctx := TestingContext(t)
+	Group(ctx, func() {
+		Override(ctx, baz, Once, func(i int) error {
+			Expectation().CheckArgs(i)
+			return nil
+		})(1)
+		Override(ctx, qux, 2, func(err error) error {
+			e := Expectation()
+			if e.RunNumber() > 1 {
+				e.Testing().Errorf("unexpected run number %d", e.RunNumber())
+			}
+			return nil
+		})
+	})
+
+	testError(t, nil, qux(errTest))
+	testError(t, nil, baz(1))
+	// baz is already restored, so this call isn't reported as unexpected, but qux is still overridden
+	testError(t, nil, baz(0))
+	testError(t, nil, qux(errTest))
+	testError(t, errTest, qux(errTest))
+
+	timeout, cancel := context.WithTimeout(context.Background(), time.Second)
+	defer cancel()
+	testError(t, nil, WaitForCalls(timeout))
+	testError(t, nil, ExpectationsWereMet())
+}
+
+func TestGroupNotMet(t *testing.T) {
+	ctx := TestingContext(t)
+	Group(ctx, func() {
+		Override(ctx, baz, Once, func(i int) error {
+			Expectation()
+			return nil
+		})
+		Override(ctx, qux, Once, func(err error) error {
+			Expectation()
+			return nil
+		})
+	})
+
+	testError(t, nil, baz(1))
+	err := ExpectationsWereMet()
+	if err == nil || !strings.Contains(err.Error(), "testaroli.qux") {
+		t.Errorf("unexpected error %v", err)
+	}
+	// all functions are restored
+	testError(t, errTest, qux(errTest))
+}
+
+func TestInvalidGroup(t *testing.T) {
+	ctx := TestingContext(t)
+	mock := func(i int) error {
+		Expectation()
+		return nil
+	}
+	cases := map[string]func(){
+		"same function": func() {
+			Override(ctx, baz, Once, mock)
+			Override(ctx, baz, Once, mock)
+		},
+		"unlimited": func() {
+			Override(ctx, baz, Unlimited, mock)
+		},
+		"same mock": func() {
+			Override(ctx, bar, Once, mock)
+			Override(ctx, baz, Once, mock)
+		},
+		"nested": func() {
+			Group(ctx, func() {})
+		},
+	}
+
+	for name, overrides := range cases {
+		func() {
+			defer func() {
+				if r := recover(); r == nil {
+					t.Errorf("case '%s' didn't panic", name)
+				}
+			}()
+			Group(ctx, overrides)
+		}()
+		ExpectationsWereMet()
+	}
+}
+
+func TestInvalidGroupNotInChain(t *testing.T) {
+	ctx := TestingContext(t)
+	func() {
+		defer func() {
+			if r := recover(); r == nil {
+				t.Errorf("didn't panic")
+			}
+		}()
+		Group(ctx, func() {
+			Override(ctx, bar, Once, func(i int) error {
+				Expectation()
+				return nil
+			})
+			Override(ctx, baz, Unlimited, func(i int) error {
+				Expectation()
+				return nil
+			})
+		})
+	}()
+
+	// only valid override is in the chain
+	if l := expectations.len(); l != 1 {
+		t.Errorf("unexpected chain length %d", l)
+	}
+	testError(t, nil, bar(1))
+	testError(t, nil, ExpectationsWereMet())
+}
@@ -0,0 +1,189 @@
+package testaroli
+
+import (
+	"context"
+	"reflect"
+	"regexp"
+	"sort"
+	"strings"
+	"sync/atomic"
+)
+
+/*
+Call describes the call of intercepted function, passed to the handler of [Intercept].
+*/
+type Call struct {
+	Func string          // fully-qualified function name, as reported by [runtime.FuncForPC]
+	Args []reflect.Value // arguments of the call, method receiver is the first argument
+}
+
+/*
+Interceptor counts the calls of intercepted functions, see [Intercept] for details.
+*/
+type Interceptor struct {
+	names []string
+	calls []atomic.Int64
+}
+
+/*
+Intercept patches all functions, whose names match regular expression <pattern>, to call
+<handler> and then the original function. If <targets> are given, functions are picked from
+them - target can be a function or method expression, or a value, in which case all exported
+methods of its type are picked. Empty pattern matches all targets, nil handler only counts the calls.
+
+It allows to find out which dependencies the code under test touches and how often:
+
+	func TestHandler(t *testing.T) {
+	    touched := Intercept(TestingContext(t), "", nil, &Store{}, &Cache{}, parseRequest)
+
+	    handler(req)
+
+	    t.Log(touched.Calls()) // map[pkg.(*Cache).Get:3 pkg.(*Store).Load:1 pkg.parseRequest:1]
+	}
+
+Methods of the value are picked like in [reflect.Type.Method], so if value is a pointer, methods
+with value receivers are included too. Original function is called through the trampoline,
+so the patch stays in effect while it runs - calls from different goroutines run in parallel,
+and recursive calls are intercepted too. Functions are patched in one batch, so each page of
+the code is made writable only once, and its protection is restored when the batch completes.
+
+Without targets functions are picked from all functions in the binary, including unexported ones,
+by their fully-qualified names, see [OverrideByName]:
+
+	touched := Intercept(TestingContext(t), `^net/http\.\(\*Transport\)\.`, nil)
+
+Signatures of such functions are unknown, so they can only be counted - <handler> must be nil and
+<pattern> can't be empty. Functions of runtime are never picked, and functions, which are too
+short to be patched, are skipped. Pattern must not match the functions testaroli itself uses to
+patch the code, like ones of sync or syscall packages.
+
+Original functions are restored when test, which context is passed to Intercept, completes.
+Like with [Override], it is necessary to disable function inlining to make Intercept work.
+*/
+func Intercept(ctx context.Context, pattern string, handler func(Call), targets ...any) *Interceptor {
+	t := Testing(ctx)
+	re := regexp.MustCompile(pattern)
+
+	in := &Interceptor{}
+	var patches []*patch
+	// patches are removed even if some function can't be patched
+	t.Cleanup(func() {
+		writeBatch(func() {
+			for _, p := range patches {
+				p.remove()
+			}
+		})
+	})
+
+	if len(targets) == 0 {
+		if handler != nil {
+			panic("Intercept() without targets can only count the calls, handler must be nil")
+		}
+		if pattern == "" {
+			panic("Intercept() without targets requires the pattern")
+		}
+		entries := interceptIndexed(re, in)
+		writeBatch(func() {
+			for i, entry := range entries {
+				patches = append(patches, newCountingStub(codePointer(entry), &in.calls[i], in))
+			}
+		})
+	} else {
+		var fns []reflect.Value
+		for _, target := range targets {
+			fns = append(fns, interceptTargets(target)...)
+		}
+		var picked []reflect.Value
+		for _, fn := range fns {
+			name := funcName(fn.UnsafePointer())
+			if re.MatchString(name) {
+				in.names = append(in.names, name)
+				picked = append(picked, fn)
+			}
+		}
+		in.calls = make([]atomic.Int64, len(picked))
+
+		writeBatch(func() {
+			for i, fn := range picked {
+				i := i
+				patches = append(patches, newHook(fn.Interface(), func(p *patch, args []reflect.Value) []reflect.Value {
+					in.calls[i].Add(1)
+					if handler != nil {
+						handler(Call{Func: in.names[i], Args: args})
+					}
+					return p.call(args)
+				}))
+			}
+		})
+	}
+
+	return in
+}
+
+// interceptIndexed picks functions, which names match <re>, from the index of all functions in
+// the binary, sets up counters of <in> for them and returns their entries
+func interceptIndexed(re *regexp.Regexp, in *Interceptor) []uintptr {
+	for name, entry := range functions().byName {
+		if strings.HasPrefix(name, "runtime.") || strings.HasPrefix(name, "runtime/") || !re.MatchString(name) {
+			continue
+		}
+		if !funcFits(codePointer(entry), stackCheckLength(entry)+entryJmpLength) {
+			continue
+		}
+		in.names = append(in.names, name)
+	}
+	sort.Strings(in.names)
+	in.calls = make([]atomic.Int64, len(in.names))
+
+	entries := make([]uintptr, len(in.names))
+	for i, name := range in.names {
+		entries[i] = functions().byName[name]
+	}
+
+	return entries
+}
+
+/*
+Calls returns the number of intercepted calls for each of intercepted functions, by function
+name. Functions, which weren't called, are not included.
+*/
+func (in *Interceptor) Calls() map[string]int {
+	calls := map[string]int{}
+	for i := range in.calls {
+		if n := in.calls[i].Load(); n > 0 {
+			calls[in.names[i]] += int(n)
+		}
+	}
+
+	return calls
+}
+
+// interceptTargets returns function itself or methods of the value
+func interceptTargets(target any) []reflect.Value {
+	typ := reflect.TypeOf(target)
+	if typ == nil {
+		panic("cannot intercept nil")
+	}
+	if typ.Kind() == reflect.Func {
+		return []reflect.Value{reflect.ValueOf(target)}
+	}
+
+	var fns []reflect.Value
+	seen := map[string]bool{}
+	// for methods with value receiver take the method itself rather than autogenerated
+	// wrapper for the pointer, so direct calls are intercepted too
+	if typ.Kind() == reflect.Pointer {
+		for i := 0; i < typ.Elem().NumMethod(); i++ {
+			m := typ.Elem().Method(i)
+			seen[m.Name] = true
+			fns = append(fns, m.Func)
+		}
+	}
+	for i := 0; i < typ.NumMethod(); i++ {
+		if m := typ.Method(i); !seen[m.Name] {
+			fns = append(fns, m.Func)
+		}
+	}
+
+	return fns
+}
@@ -0,0 +1,81 @@
+package testaroli
+
+import (
+	"reflect"
+	"testing"
+)
+
+func TestIntercept(t *testing.T) {
+	var args []int
+	touched := Intercept(TestingContext(t), "", func(c Call) {
+		if c.Func == "github.com/qrdl/testaroli.baz" {
+			args = append(args, int(c.Args[0].Int()))
+		}
+	}, bar, baz, qux)
+
+	testError(t, nil, foo(102))
+
+	calls := touched.Calls()
+	expected := map[string]int{
+		"github.com/qrdl/testaroli.bar": 1,
+		"github.com/qrdl/testaroli.baz": 2,
+		"github.com/qrdl/testaroli.qux": 1,
+	}
+	if !reflect.DeepEqual(calls, expected) {
+		t.Errorf("unexpected calls %v", calls)
+	}
+	if !reflect.DeepEqual(args, []int{100, 101}) {
+		t.Errorf("unexpected args %v", args)
+	}
+}
+
+func TestInterceptMethods(t *testing.T) {
+	touched := Intercept(TestingContext(t), `\.Greet$`, nil, &english{}, &french{})
+
+	greet(&english{}, "Bob")
+	greet(french{}, "Bob")
+	french{}.Greet("Bob")
+	greeter(french{}).Name()
+
+	calls := touched.Calls()
+	expected := map[string]int{
+		"github.com/qrdl/testaroli.(*english).Greet": 1,
+		"github.com/qrdl/testaroli.french.Greet":     2,
+	}
+	if !reflect.DeepEqual(calls, expected) {
+		t.Errorf("unexpected calls %v", calls)
+	}
+}
+
+func TestInterceptIndexed(t *testing.T) {
+	touched := Intercept(TestingContext(t), `^github\.com/qrdl/testaroli\.(bar|baz)$`, nil)
+
+	testError(t, nil, foo(102))
+
+	calls := touched.Calls()
+	expected := map[string]int{
+		"github.com/qrdl/testaroli.bar": 1,
+		"github.com/qrdl/testaroli.baz": 2,
+	}
+	if !reflect.DeepEqual(calls, expected) {
+		t.Errorf("unexpected calls %v", calls)
+	}
+}
+
+func TestInvalidInterceptIndexed(t *testing.T) {
+	ctx := TestingContext(t)
+	cases := map[string]func(){
+		"empty pattern": func() { Intercept(ctx, "", nil) },
+		"handler":       func() { Intercept(ctx, "bar$", func(Call) {}) },
+	}
+	for name, intercept := range cases {
+		func() {
+			defer func() {
+				if r := recover(); r == nil {
+					t.Errorf("case '%s' didn't panic", name)
+				}
+			}()
+			intercept()
+		}()
+	}
+}
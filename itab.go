@@ -0,0 +1,111 @@
+package testaroli
+
+import (
+	"context"
+	"fmt"
+	"reflect"
+	"sync/atomic"
+	"unsafe"
+)
+
+// offset of the method table in runtime's itab structure
+const itabFunOffset = 3 * unsafe.Sizeof(uintptr(0))
+
+/*
+OverrideInterface overrides method <method> of interface I for the dynamic type of <impl>,
+so all calls of the method through interface I for values of this type call <mock> instead.
+Method is overridden by atomically replacing the pointer in the method table for the
+(interface, type) pair, so function code isn't modified, and concurrent calls see either
+original method or the mock.
+
+Like with [Override], receiver becomes the first argument of the mock. If dynamic type of
+<impl> is a pointer (or other pointer-shaped type, like map or channel), receiver has the
+same type, otherwise receiver is a pointer to the value:
+
+	type Store interface {
+	    Get(key string) (string, error)
+	}
+
+	func TestLookup(t *testing.T) {
+	    var store Store = &RedisStore{}
+	    OverrideInterface(TestingContext(t), store, "Get", func(s *RedisStore, key string) (string, error) {
+	        return "bar", nil
+	    })
+
+	    if lookup(store, "foo") != "bar" {
+	        ...
+	    }
+	}
+
+OverrideInterface affects only the calls through interface I - direct calls of the method
+and calls through other interfaces use the original method. Like with [Override], mock can't
+use the variables from enclosing scope. Original method is restored when test, which
+context is passed to OverrideInterface, completes.
+*/
+func OverrideInterface[I any](ctx context.Context, impl I, method string, mock any) {
+	t := Testing(ctx)
+
+	ifaceType := reflect.TypeOf((*I)(nil)).Elem()
+	if ifaceType.Kind() != reflect.Interface || ifaceType.NumMethod() == 0 {
+		panic("OverrideInterface() can be called only for non-empty interface")
+	}
+	itab := (*[2]unsafe.Pointer)(unsafe.Pointer(&impl))[0]
+	if itab == nil {
+		panic("OverrideInterface() can't be called for nil interface")
+	}
+
+	m, ok := ifaceType.MethodByName(method)
+	if !ok {
+		panic(fmt.Sprintf("interface %s has no method %s", ifaceType, method))
+	}
+	checkMethodMock(reflect.TypeOf(impl), m.Type, reflect.TypeOf(mock))
+
+	// method table has the same order of methods as reflect
+	slot := unsafe.Add(itab, itabFunOffset+uintptr(m.Index)*unsafe.Sizeof(uintptr(0)))
+	orgMethod := atomic.LoadPointer((*unsafe.Pointer)(slot))
+
+	stats.overrides.Add(1)
+	// pointer is stored atomically, so calls from other goroutines never see partially written one
+	writePointer(slot, reflect.ValueOf(mock).UnsafePointer()) // OS-specific
+
+	t.Cleanup(func() { writePointer(slot, orgMethod) })
+}
+
+// checkMethodMock panics if <mock> doesn't match interface method <method> of type <typ>
+func checkMethodMock(typ, method, mock reflect.Type) {
+	recv := typ
+	if !isDirectIface(typ) {
+		// such values are stored in interface as pointers
+		recv = reflect.PointerTo(typ)
+	}
+
+	ok := mock != nil &&
+		mock.Kind() == reflect.Func &&
+		mock.NumIn() == method.NumIn()+1 &&
+		mock.NumOut() == method.NumOut() &&
+		mock.In(0) == recv &&
+		mock.IsVariadic() == method.IsVariadic()
+	for i := 0; ok && i < method.NumIn(); i++ {
+		ok = mock.In(i+1) == method.In(i)
+	}
+	for i := 0; ok && i < method.NumOut(); i++ {
+		ok = mock.Out(i) == method.Out(i)
+	}
+	if !ok {
+		panic(fmt.Sprintf("mock must have %s receiver and match method signature %s", recv, method))
+	}
+}
+
+// isDirectIface reports whether values of type <typ> are stored directly in the interface
+func isDirectIface(typ reflect.Type) bool {
+	switch typ.Kind() {
+	case reflect.Pointer, reflect.Map, reflect.Chan, reflect.Func, reflect.UnsafePointer:
+		return true
+	case reflect.Struct:
+		return typ.NumField() == 1 && isDirectIface(typ.Field(0).Type)
+	case reflect.Array:
+		return typ.Len() == 1 && isDirectIface(typ.Elem())
+	}
+
+	return false
+}
@@ -0,0 +1,86 @@
+package testaroli
+
+import (
+	"testing"
+)
+
+type greeter interface {
+	Greet(name string) string
+	Name() string
+}
+
+type english struct{ polite bool }
+
+func (e *english) Greet(name string) string { return "Hello, " + name }
+
+func (e *english) Name() string { return "English" }
+
+type french struct{ accent string }
+
+func (f french) Greet(name string) string { return "Bonjour, " + name }
+
+func (f french) Name() string { return "French" }
+
+func greet(g greeter, name string) string {
+	return g.Greet(name)
+}
+
+func mockEnglishGreet(e *english, name string) string {
+	return "Hi, " + name
+}
+
+func mockFrenchGreet(f *french, name string) string {
+	return "Salut, " + name
+}
+
+func TestInterfacePointerReceiver(t *testing.T) {
+	t.Run("overridden", func(t *testing.T) {
+		OverrideInterface[greeter](TestingContext(t), &english{}, "Greet", mockEnglishGreet)
+
+		if res := greet(&english{}, "Bob"); res != "Hi, Bob" {
+			t.Errorf("unexpected greeting %s", res)
+		}
+		// other types and methods are not affected
+		if res := greet(french{}, "Bob"); res != "Bonjour, Bob" {
+			t.Errorf("unexpected greeting %s", res)
+		}
+		if res := greeter(&english{}).Name(); res != "English" {
+			t.Errorf("unexpected name %s", res)
+		}
+	})
+
+	if res := greet(&english{}, "Bob"); res != "Hello, Bob" {
+		t.Errorf("original method wasn't restored, got %s", res)
+	}
+}
+
+func TestInterfaceValueReceiver(t *testing.T) {
+	OverrideInterface[greeter](TestingContext(t), french{}, "Greet", mockFrenchGreet)
+
+	if res := greet(french{accent: "Paris"}, "Bob"); res != "Salut, Bob" {
+		t.Errorf("unexpected greeting %s", res)
+	}
+}
+
+func TestInterfaceWrongMock(t *testing.T) {
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("The code did not panic")
+		}
+	}()
+
+	// value receiver instead of pointer
+	OverrideInterface[greeter](TestingContext(t), french{}, "Greet", func(f french, name string) string {
+		return ""
+	})
+}
+
+func TestInterfaceWrongMethod(t *testing.T) {
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("The code did not panic")
+		}
+	}()
+
+	OverrideInterface[greeter](TestingContext(t), french{}, "Bye", mockFrenchGreet)
+}
@@ -0,0 +1,54 @@
+package testaroli
+
+import (
+	"context"
+	"reflect"
+	"runtime/pprof"
+	"unsafe"
+)
+
+/*
+ProfileLabels enables tagging of mock execution with pprof labels "testaroli.func", holding
+the name of overridden function, and "testaroli.mock", holding the name of the mock, so in
+CPU profile the time, spent in mocks, can be separated from the time, spent in the code under
+test, e.g. with `go tool pprof -tagfocus testaroli.func=.`. Labels are set for overrides,
+made with [Override] after ProfileLabels is set, and they are enabled automatically if test
+binary is run with -cpuprofile.
+
+With labels enabled, overridden function jumps to the wrapper, which sets the labels, calls
+the mock and removes the labels when the mock returns, so calls of overridden functions
+become slower. Labels, set by the code under test before the call, are kept, and the mock
+sees them together with testaroli ones.
+*/
+var ProfileLabels = false
+
+// profileLabels reports whether mock execution needs to be tagged with pprof labels
+func profileLabels() bool {
+	return ProfileLabels || flagValue("test.cpuprofile") != ""
+}
+
+// withLabels returns the function, which makes <call>, tagging the goroutine with pprof labels
+// for <e>, added to the labels of the caller, and restores the labels of the caller after the call
+func withLabels(e *Expect, call mockCall) mockCall {
+	labels := pprof.Labels("testaroli.func", e.orgName, "testaroli.mock", funcName(e.mockAddr))
+
+	return func(args []reflect.Value) []reflect.Value {
+		saved := getProfLabel()
+		defer setProfLabel(saved)
+
+		ctx := pprof.WithLabels(context.Background(), pprof.Labels(goroutineLabels(saved)...))
+		pprof.SetGoroutineLabels(pprof.WithLabels(ctx, labels))
+
+		return call(args)
+	}
+}
+
+// getProfLabel returns the labels of current goroutine, as set by pprof
+//
+//go:linkname getProfLabel runtime/pprof.runtime_getProfLabel
+func getProfLabel() unsafe.Pointer
+
+// setProfLabel sets the labels of current goroutine, returned by getProfLabel
+//
+//go:linkname setProfLabel runtime/pprof.runtime_setProfLabel
+func setProfLabel(labels unsafe.Pointer)
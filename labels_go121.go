@@ -0,0 +1,19 @@
+//go:build !go1.24
+
+package testaroli
+
+import "unsafe"
+
+// goroutineLabels returns key-value pairs of pprof labels, returned by getProfLabel - before
+// Go 1.24 labels are stored as the map
+func goroutineLabels(labels unsafe.Pointer) []string {
+	if labels == nil {
+		return nil
+	}
+	var pairs []string
+	for k, v := range *(*map[string]string)(labels) {
+		pairs = append(pairs, k, v)
+	}
+
+	return pairs
+}
@@ -0,0 +1,20 @@
+//go:build go1.24
+
+package testaroli
+
+import "unsafe"
+
+// goroutineLabels returns key-value pairs of pprof labels, returned by getProfLabel - since
+// Go 1.24 labels are stored as the slice, sorted by key
+func goroutineLabels(labels unsafe.Pointer) []string {
+	if labels == nil {
+		return nil
+	}
+	set := (*struct{ list []struct{ key, value string } })(labels)
+	pairs := make([]string, 0, 2*len(set.list))
+	for _, l := range set.list {
+		pairs = append(pairs, l.key, l.value)
+	}
+
+	return pairs
+}
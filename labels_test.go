@@ -0,0 +1,83 @@
+package testaroli
+
+import (
+	"bytes"
+	"context"
+	"reflect"
+	"runtime/pprof"
+	"strings"
+	"testing"
+)
+
+// goroutine profile, taken from the mock, mocks can't use variables from enclosing scope
+var mockProfile bytes.Buffer
+
+func TestProfileLabels(t *testing.T) {
+	ProfileLabels = true
+	defer func() { ProfileLabels = false }()
+
+	mockProfile.Reset()
+	Override(TestingContext(t), bar, 2, func(i int) error {
+		Expectation().CheckArgs(i)
+		if mockProfile.Len() == 0 {
+			// some Go versions don't report labels of the goroutine, which takes the profile
+			done := make(chan struct{})
+			go func() {
+				pprof.Lookup("goroutine").WriteTo(&mockProfile, 1)
+				close(done)
+			}()
+			<-done
+		}
+		return nil
+	})(2)
+
+	testError(t, nil, foo(1))
+	testError(t, nil, foo(1))
+	testError(t, nil, ExpectationsWereMet())
+
+	label := `"testaroli.func":"github.com/qrdl/testaroli.bar"`
+	if !strings.Contains(mockProfile.String(), label) {
+		t.Errorf("mock isn't labeled:\n%s", mockProfile.String())
+	}
+
+	var buf bytes.Buffer
+	pprof.Lookup("goroutine").WriteTo(&buf, 1)
+	if strings.Contains(buf.String(), label) {
+		t.Errorf("labels aren't removed after the mock returned")
+	}
+}
+
+// labels of the goroutine, seen by the mock
+var mockLabels map[string]string
+
+func labelMap(pairs []string) map[string]string {
+	m := map[string]string{}
+	for i := 0; i+1 < len(pairs); i += 2 {
+		m[pairs[i]] = pairs[i+1]
+	}
+	return m
+}
+
+func TestProfileLabelsKeepCallerLabels(t *testing.T) {
+	ProfileLabels = true
+	defer func() { ProfileLabels = false }()
+
+	Override(TestingContext(t), bar, Once, func(i int) error {
+		Expectation()
+		mockLabels = labelMap(goroutineLabels(getProfLabel()))
+		return nil
+	})
+
+	pprof.Do(context.Background(), pprof.Labels("request", "42"), func(context.Context) {
+		testError(t, nil, foo(1))
+
+		if labels := labelMap(goroutineLabels(getProfLabel())); !reflect.DeepEqual(labels, map[string]string{"request": "42"}) {
+			t.Errorf("labels of the caller aren't restored: %v", labels)
+		}
+	})
+	testError(t, nil, ExpectationsWereMet())
+
+	if mockLabels["request"] != "42" || mockLabels["testaroli.func"] != "github.com/qrdl/testaroli.bar" {
+		t.Errorf("unexpected labels of the mock %v", mockLabels)
+	}
+}
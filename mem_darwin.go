@@ -10,6 +10,10 @@ package testaroli
 #include <mach/mach_vm.h>
 #include <mach/task.h>
 #include <mach/thread_act.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <pthread.h>
+#include <libkern/OSCacheControl.h>
 
 #define CHECK_ERR(MSG) if (ret != 0) { fprintf(stderr, "%d: %s: %d\n", __LINE__, MSG, ret); return ret; }
 
@@ -146,6 +150,35 @@ static int overwrite(mach_vm_address_t src, mach_vm_size_t size, mach_vm_address
     return 0;
 }
 
+// make_data_writable makes read-only data, like method tables, writable
+int make_data_writable(uint64_t addr, uint64_t size) {
+    task_t task;
+    task_for_pid(mach_task_self(), getpid(), &task);
+
+    kern_return_t ret = mach_vm_protect(task, addr, size, 0, VM_PROT_READ|VM_PROT_WRITE);
+    CHECK_ERR("mach_vm_protect");
+
+    return 0;
+}
+
+// map_code maps executable memory for trampolines, MAP_JIT allows to write it on Apple Silicon
+void *map_code(uint64_t hint, uint64_t size) {
+    void *addr = mmap((void *)hint, size, PROT_READ|PROT_WRITE|PROT_EXEC, MAP_PRIVATE|MAP_ANON|MAP_JIT, -1, 0);
+    return addr == MAP_FAILED ? NULL : addr;
+}
+
+// write_code writes the code to the memory, mapped with map_code
+void write_code(uint64_t dest, uint64_t src, uint64_t size) {
+#if defined(__aarch64__)
+    pthread_jit_write_protect_np(0);
+#endif
+    memcpy((void *)dest, (void *)src, size);
+#if defined(__aarch64__)
+    pthread_jit_write_protect_np(1);
+#endif
+    sys_icache_invalidate((void *)dest, size);
+}
+
 // this function must not update any globals because TEMP segment is not writable!
 static int suspend_other_threads() {
     task_t task;
@@ -189,7 +222,11 @@ static int resume_other_threads() {
 import "C"
 
 import (
+	"errors"
 	"runtime"
+	"sync/atomic"
+	"testing"
+	"time"
 	"unsafe"
 )
 
@@ -205,8 +242,50 @@ func init() {
 }
 
 func replacePrologue(ptr unsafe.Pointer, buf []byte) {
+	defer countWrite(time.Now())
+	stats.protects.Add(1) // text segment is remapped for every write
+
 	res := C.overwrite_prolog(C.uint64_t(uintptr(ptr)), C.uint64_t(uintptr(unsafe.Pointer(&buf[0]))), C.uint64_t(len(buf)))
 	if res != 0 {
 		panic("cannot overwrite function prologue")
 	}
 }
+
+// writePointer atomically stores <value> at <slot> in read-only data, like method table
+func writePointer(slot, value unsafe.Pointer) {
+	defer countWrite(time.Now())
+	stats.protects.Add(1)
+
+	if C.make_data_writable(C.uint64_t(uintptr(slot)), C.uint64_t(unsafe.Sizeof(value))) != 0 {
+		panic("cannot make the data writable")
+	}
+	atomic.StorePointer((*unsafe.Pointer)(slot), value)
+}
+
+// restoreAfter does nothing - text segment is remapped for every write, and it stays writable
+func restoreAfter(t *testing.T) {}
+
+// writeBatch calls <f>, which patches many functions - text segment is remapped for every
+// write, so writes aren't batched
+func writeBatch(f func()) {
+	f()
+}
+
+// mapCode maps <size> bytes of executable memory for trampolines, at <hint>, if it is free
+func mapCode(hint, size uintptr) (uintptr, error) {
+	addr := C.map_code(C.uint64_t(hint), C.uint64_t(size))
+	if addr == nil {
+		return 0, errors.New("cannot map memory for the code")
+	}
+
+	return uintptr(addr), nil
+}
+
+func unmapCode(addr, size uintptr) {
+	C.munmap(unsafe.Pointer(addr), C.size_t(size))
+}
+
+// writeCode writes <code> to the memory, mapped with mapCode
+func writeCode(dst unsafe.Pointer, code []byte) {
+	C.write_code(C.uint64_t(uintptr(dst)), C.uint64_t(uintptr(unsafe.Pointer(&code[0]))), C.uint64_t(len(code)))
+}
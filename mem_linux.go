@@ -1,32 +1,129 @@
 package testaroli
 
 import (
+	"fmt"
 	"os"
+	"strconv"
+	"strings"
+	"sync/atomic"
+	"time"
 	"unsafe"
 
 	"golang.org/x/sys/unix"
 )
 
+/*
+replacePrologue writes <buf> over the code at <ptr>, making only the pages, which contain it,
+writable. Test binary text is mapped from the file, so it is backed by huge pages only if the
+kernel collapses read-only file pages (CONFIG_READ_ONLY_THP_FOR_FS); changing protection of the
+part of such huge page splits it into small pages, and code isn't remapped to keep it huge.
+*/
 func replacePrologue(ptr unsafe.Pointer, buf []byte) {
-	err := makeMemRX(ptr, len(buf))
+	defer countWrite(time.Now())
+
+	start, size := calcBoundaries(uintptr(ptr), len(buf))
+	writeMem(start, size, unix.PROT_READ|unix.PROT_WRITE|unix.PROT_EXEC, textProtection, func() {
+		copy(unsafe.Slice((*uint8)(ptr), len(buf)), buf)
+	})
+}
+
+// writePointer atomically stores <value> at <slot> in read-only data, like method table
+func writePointer(slot, value unsafe.Pointer) {
+	defer countWrite(time.Now())
+
+	writeMem(uintptr(slot), unsafe.Sizeof(value), unix.PROT_READ|unix.PROT_WRITE, memProtection, func() {
+		atomic.StorePointer((*unsafe.Pointer)(slot), value)
+	})
+}
+
+func setProtection(start, size uintptr, prot uint32) error {
+	return unix.Mprotect(unsafe.Slice((*uint8)(codePointer(start)), size), int(prot))
+}
+
+// textProtection returns the protection of the code at <addr> - code is always mapped read-only
+func textProtection(addr uintptr) uint32 {
+	return unix.PROT_READ | unix.PROT_EXEC
+}
+
+// memProtection returns the protection of the mapping, which contains <addr>
+func memProtection(addr uintptr) uint32 {
+	data, err := readProcFile("/proc/self/maps")
 	if err != nil {
 		panic(err)
 	}
-	funcPrologue := unsafe.Slice((*uint8)(ptr), len(buf))
-	copy(funcPrologue, buf)
+
+	for _, line := range strings.Split(string(data), "\n") {
+		// "start-end perms offset dev inode [path]"
+		fields := strings.Fields(line)
+		if len(fields) < 2 {
+			continue
+		}
+		from, to, _ := strings.Cut(fields[0], "-")
+		start, err1 := strconv.ParseUint(from, 16, 64)
+		end, err2 := strconv.ParseUint(to, 16, 64)
+		if err1 != nil || err2 != nil || addr < uintptr(start) || addr >= uintptr(end) {
+			continue
+		}
+		var prot uint32
+		for i, bit := range []uint32{unix.PROT_READ, unix.PROT_WRITE, unix.PROT_EXEC} {
+			if fields[1][i] != '-' {
+				prot |= bit
+			}
+		}
+		return prot
+	}
+
+	panic(fmt.Sprintf("address %#x isn't mapped", addr))
+}
+
+// readProcFile reads the file with system calls, as functions of os package can be overridden
+// by the test, e.g. with [FakeFS], while the code is patched
+func readProcFile(path string) ([]byte, error) {
+	fd, err := unix.Open(path, unix.O_RDONLY|unix.O_CLOEXEC, 0)
+	if err != nil {
+		return nil, err
+	}
+	defer unix.Close(fd)
+
+	var data []byte
+	buf := make([]byte, 64<<10)
+	for {
+		n, err := unix.Read(fd, buf)
+		if err != nil {
+			return nil, err
+		}
+		if n == 0 {
+			return data, nil
+		}
+		data = append(data, buf[:n]...)
+	}
+}
+
+// mapCode maps <size> bytes of executable memory for trampolines, at <hint>, if it is free
+func mapCode(hint, size uintptr) (uintptr, error) {
+	addr, _, errno := unix.Syscall6(unix.SYS_MMAP, hint, size, uintptr(unix.PROT_READ|unix.PROT_WRITE|unix.PROT_EXEC),
+		uintptr(unix.MAP_PRIVATE|unix.MAP_ANON), ^uintptr(0), 0)
+	if errno != 0 {
+		return 0, errno
+	}
+
+	return addr, nil
 }
 
-func makeMemRX(ptr unsafe.Pointer, size int) error {
-	start, sz := calcBoundaries(ptr, size)
+func unmapCode(addr, size uintptr) {
+	unix.Syscall(unix.SYS_MUNMAP, addr, size, 0)
+}
 
-	page := unsafe.Slice((*uint8)(start), sz)
-	return unix.Mprotect(page, unix.PROT_WRITE|unix.PROT_READ|unix.PROT_EXEC)
+// writeCode writes <code> to the memory, mapped with mapCode
+func writeCode(dst unsafe.Pointer, code []byte) {
+	copy(unsafe.Slice((*byte)(dst), len(code)), code)
 }
 
-func calcBoundaries(ptr unsafe.Pointer, size int) (unsafe.Pointer, uintptr) {
+// calcBoundaries returns the start and the size of the pages, which contain <size> bytes at <addr>
+func calcBoundaries(addr uintptr, size int) (uintptr, uintptr) {
 	pageSize := uintptr(os.Getpagesize())
-	areaStart := unsafe.Pointer(uintptr(ptr) &^ (pageSize - 1))
-	areaSize := (uintptr(ptr) + uintptr(size)) - uintptr(areaStart)
+	areaStart := addr &^ (pageSize - 1)
+	areaSize := addr + uintptr(size) - areaStart
 
 	return areaStart, areaSize
 }
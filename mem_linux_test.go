@@ -2,13 +2,15 @@ package testaroli
 
 import (
 	"os"
+	"reflect"
 	"testing"
-	"unsafe"
+
+	"golang.org/x/sys/unix"
 )
 
 func TestSinglePage(t *testing.T) {
-	ptr, size := calcBoundaries(unsafe.Pointer(uintptr(0x10)), 0x10)
-	if ptr != unsafe.Pointer(uintptr(0x00)) {
+	start, size := calcBoundaries(0x10, 0x10)
+	if start != 0x00 {
 		t.Error("incorrect page start")
 	}
 	if size != 32 {
@@ -19,8 +21,8 @@ func TestSinglePage(t *testing.T) {
 func TestEndOfPage(t *testing.T) {
 	pageSize := uintptr(os.Getpagesize())
 
-	ptr, size := calcBoundaries(unsafe.Pointer(pageSize-uintptr(0x10)), 0x10)
-	if ptr != unsafe.Pointer(uintptr(0x00)) {
+	start, size := calcBoundaries(pageSize-0x10, 0x10)
+	if start != 0x00 {
 		t.Error("incorrect page start")
 	}
 	if size != pageSize {
@@ -31,8 +33,8 @@ func TestEndOfPage(t *testing.T) {
 func TestTwoPages(t *testing.T) {
 	pageSize := uintptr(os.Getpagesize())
 
-	ptr, size := calcBoundaries(unsafe.Pointer(pageSize-0x4), 0x10)
-	if ptr != unsafe.Pointer(uintptr(0x00)) {
+	start, size := calcBoundaries(pageSize-0x4, 0x10)
+	if start != 0x00 {
 		t.Error("incorrect page start")
 	}
 	expectedsize := pageSize + 0x10 - 0x4
@@ -40,3 +42,30 @@ func TestTwoPages(t *testing.T) {
 		t.Errorf("expected %x, got %x as area size", expectedsize, size)
 	}
 }
+
+func TestProtectionRestored(t *testing.T) {
+	addr := reflect.ValueOf(bar).Pointer()
+	checkProtection := func(expected uint32, when string) {
+		t.Helper()
+		if prot := memProtection(addr); prot != expected {
+			t.Errorf("unexpected protection %#x of the code %s", prot, when)
+		}
+	}
+
+	t.Run("intercept", func(t *testing.T) {
+		Intercept(TestingContext(t), "", nil, bar, baz, qux)
+		checkProtection(unix.PROT_READ|unix.PROT_EXEC, "after batch")
+	})
+	checkProtection(unix.PROT_READ|unix.PROT_EXEC, "after restoring")
+
+	t.Run("override", func(t *testing.T) {
+		Override(TestingContext(t), bar, Once, func(i int) error {
+			Expectation()
+			return nil
+		})
+		checkProtection(unix.PROT_READ|unix.PROT_WRITE|unix.PROT_EXEC, "while test runs")
+		testError(t, nil, foo(1))
+		testError(t, nil, ExpectationsWereMet())
+	})
+	checkProtection(unix.PROT_READ|unix.PROT_EXEC, "after test")
+}
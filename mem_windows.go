@@ -1,25 +1,60 @@
 package testaroli
 
 import (
+	"sync/atomic"
+	"time"
 	"unsafe"
 
 	"golang.org/x/sys/windows"
 )
 
 func replacePrologue(ptr unsafe.Pointer, buf []byte) {
-	err := makeMemRX(ptr, len(buf))
-	if err != nil {
+	defer countWrite(time.Now())
+
+	writeMem(uintptr(ptr), uintptr(len(buf)), windows.PAGE_EXECUTE_READWRITE, textProtection, func() {
+		copy(unsafe.Slice((*uint8)(ptr), len(buf)), buf)
+	})
+}
+
+// writePointer atomically stores <value> at <slot> in read-only data, like method table
+func writePointer(slot, value unsafe.Pointer) {
+	defer countWrite(time.Now())
+
+	writeMem(uintptr(slot), unsafe.Sizeof(value), windows.PAGE_READWRITE, memProtection, func() {
+		atomic.StorePointer((*unsafe.Pointer)(slot), value)
+	})
+}
+
+func setProtection(start, size uintptr, prot uint32) error {
+	var oldPerms uint32
+	return windows.VirtualProtect(start, size, prot, &oldPerms)
+}
+
+// textProtection returns the protection of the code at <addr> - code is always mapped read-only
+func textProtection(addr uintptr) uint32 {
+	return windows.PAGE_EXECUTE_READ
+}
+
+// memProtection returns the protection of the page, which contains <addr>
+func memProtection(addr uintptr) uint32 {
+	var info windows.MemoryBasicInformation
+	if err := windows.VirtualQuery(addr, &info, unsafe.Sizeof(info)); err != nil {
 		panic(err)
 	}
-	funcPrologue := unsafe.Slice((*uint8)(ptr), len(buf))
-	copy(funcPrologue, buf)
+
+	return info.Protect
 }
 
-func makeMemRX(ptr unsafe.Pointer, size int) error {
-	var oldPerms uint32
-	return windows.VirtualProtect(
-		uintptr(ptr),
-		uintptr(size),
-		windows.PAGE_EXECUTE_READWRITE,
-		&oldPerms)
+// mapCode maps <size> bytes of executable memory for trampolines, at <hint>, if it is free
+func mapCode(hint, size uintptr) (uintptr, error) {
+	return windows.VirtualAlloc(hint, size, windows.MEM_COMMIT|windows.MEM_RESERVE, windows.PAGE_EXECUTE_READWRITE)
+}
+
+func unmapCode(addr, size uintptr) {
+	windows.VirtualFree(addr, 0, windows.MEM_RELEASE)
+}
+
+// writeCode writes <code> to the memory, mapped with mapCode
+func writeCode(dst unsafe.Pointer, code []byte) {
+	copy(unsafe.Slice((*byte)(dst), len(code)), code)
 }
@@ -0,0 +1,403 @@
+package testaroli
+
+import (
+	"context"
+	"io"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"time"
+)
+
+type memFS struct {
+	mu      sync.Mutex
+	root    *memNode
+	files   map[*os.File]*memHandle
+	nextFd  uintptr
+	patches []*patch
+	// patches for methods that may be called for real files, like os.Stdout
+	fileRead  *patch
+	fileWrite *patch
+	fileClose *patch
+	fileStat  *patch
+}
+
+type memNode struct {
+	name     string
+	data     []byte // written in place, unless readers copy it without holding the lock
+	gen      int    // incremented when data is reallocated
+	readers  int    // number of readers, copying current data
+	mode     fs.FileMode
+	modTime  time.Time
+	children map[string]*memNode // nil for regular files
+}
+
+type memHandle struct {
+	node   *memNode
+	name   string
+	flag   int
+	offset int64
+	closed bool
+}
+
+type memFileInfo struct {
+	name    string
+	size    int64
+	mode    fs.FileMode
+	modTime time.Time
+}
+
+// descriptors for fake files start way above any real descriptor limit
+const memFdBase = 1 << 31
+
+var activeFS atomic.Pointer[memFS]
+
+/*
+FakeFS overrides [os.OpenFile], [os.ReadFile], [os.WriteFile], [os.Stat] and [os.File] methods Read,
+Write, Close and Stat to use in-memory file system instead of the real one. [os.Open] and [os.Create]
+use [os.OpenFile] internally, so they use in-memory file system too.
+
+In-memory file system starts empty, and the files, created by the test, never reach the disk.
+Parent directories are created implicitly when file is created. File content grows in place,
+like a slice with append, and it is copied on write only while [os.ReadFile] copies it, so
+readers never see partially written data.
+
+	func TestSaveConfig(t *testing.T) {
+	    FakeFS(TestingContext(t))
+
+	    if err := saveConfig("/etc/app/config.json", cfg); err != nil {
+	        t.Error(err)
+	    }
+	    data, _ := os.ReadFile("/etc/app/config.json")
+	    ...
+	}
+
+Files, opened before FakeFS was called, including [os.Stdin], [os.Stdout] and [os.Stderr],
+keep working with the real file system. Original functions are restored when test, which
+context is passed to FakeFS, completes. Only one in-memory file system can be active
+at any time. Like with [Override], it is necessary to disable function inlining to
+make FakeFS work.
+*/
+func FakeFS(ctx context.Context) {
+	t := Testing(ctx)
+
+	mfs := &memFS{
+		root:   &memNode{mode: fs.ModeDir | 0755, children: map[string]*memNode{}},
+		files:  map[*os.File]*memHandle{},
+		nextFd: memFdBase,
+	}
+	if !activeFS.CompareAndSwap(nil, mfs) {
+		panic("In-memory file system is already active")
+	}
+
+	mfs.fileRead = newPatch((*os.File).Read, fakeFileRead)
+	mfs.fileWrite = newPatch((*os.File).Write, fakeFileWrite)
+	mfs.fileClose = newPatch((*os.File).Close, fakeFileClose)
+	mfs.fileStat = newPatch((*os.File).Stat, fakeFileStat)
+	mfs.patches = []*patch{
+		newPatch(os.OpenFile, fakeOpenFile),
+		newPatch(os.ReadFile, fakeReadFile),
+		newPatch(os.WriteFile, fakeWriteFile),
+		newPatch(os.Stat, fakeStat),
+		mfs.fileRead,
+		mfs.fileWrite,
+		mfs.fileClose,
+		mfs.fileStat,
+	}
+
+	t.Cleanup(mfs.restore)
+}
+
+func (mfs *memFS) restore() {
+	for _, p := range mfs.patches {
+		p.remove()
+	}
+	activeFS.Store(nil)
+}
+
+func splitPath(name string) []string {
+	name = filepath.ToSlash(filepath.Clean(name))
+	if name == "/" || name == "." {
+		return nil
+	}
+	return strings.Split(strings.TrimPrefix(name, "/"), "/")
+}
+
+// lookup returns the node for <name> and its parent directory. If <create> is set, missing
+// parent directories are created
+func (mfs *memFS) lookup(name string, create bool) (*memNode, *memNode, string, error) {
+	parts := splitPath(name)
+	if len(parts) == 0 {
+		return mfs.root, nil, "/", nil
+	}
+	dir := mfs.root
+	for _, p := range parts[:len(parts)-1] {
+		next, ok := dir.children[p]
+		if !ok {
+			if !create {
+				return nil, nil, "", fs.ErrNotExist
+			}
+			next = &memNode{name: p, mode: fs.ModeDir | 0755, modTime: time.Now(), children: map[string]*memNode{}}
+			dir.children[p] = next
+		}
+		if next.children == nil {
+			return nil, nil, "", syscall.ENOTDIR
+		}
+		dir = next
+	}
+	base := parts[len(parts)-1]
+	return dir.children[base], dir, base, nil
+}
+
+func (mfs *memFS) open(name string, flag int, perm fs.FileMode) (*memNode, error) {
+	node, dir, base, err := mfs.lookup(name, flag&os.O_CREATE != 0)
+	if err != nil {
+		return nil, err
+	}
+	if node == nil {
+		if flag&os.O_CREATE == 0 {
+			return nil, fs.ErrNotExist
+		}
+		node = &memNode{name: base, mode: perm & fs.ModePerm, modTime: time.Now()}
+		dir.children[base] = node
+	} else if flag&(os.O_CREATE|os.O_EXCL) == os.O_CREATE|os.O_EXCL {
+		return nil, fs.ErrExist
+	}
+	if node.children != nil && flag&(os.O_WRONLY|os.O_RDWR) != 0 {
+		return nil, syscall.EISDIR
+	}
+	if flag&os.O_TRUNC != 0 {
+		node.data, node.readers = nil, 0
+		node.gen++
+		node.modTime = time.Now()
+	}
+
+	return node, nil
+}
+
+// write writes <b> at <offset>, content is reallocated if it's too short or if it is being read
+func (node *memNode) write(b []byte, offset int64) {
+	end := offset + int64(len(b))
+	if node.readers > 0 || end > int64(cap(node.data)) {
+		size := max(end, int64(len(node.data)))
+		data := make([]byte, size, max(size, 2*int64(cap(node.data))))
+		copy(data, node.data)
+		node.data, node.readers = data, 0
+		node.gen++
+	} else if end > int64(len(node.data)) {
+		node.data = node.data[:end]
+	}
+	copy(node.data[offset:], b)
+	node.modTime = time.Now()
+}
+
+func (node *memNode) info() fs.FileInfo {
+	return memFileInfo{name: node.name, size: int64(len(node.data)), mode: node.mode, modTime: node.modTime}
+}
+
+func (fi memFileInfo) Name() string       { return fi.name }
+func (fi memFileInfo) Size() int64        { return fi.size }
+func (fi memFileInfo) Mode() fs.FileMode  { return fi.mode }
+func (fi memFileInfo) ModTime() time.Time { return fi.modTime }
+func (fi memFileInfo) IsDir() bool        { return fi.mode.IsDir() }
+func (fi memFileInfo) Sys() any           { return nil }
+
+// Mocks below are plain functions, not closures, because mock is executed in the scope of
+// original function, so they find file system through the package-level variable.
+
+func fakeOpenFile(name string, flag int, perm fs.FileMode) (*os.File, error) {
+	mfs := activeFS.Load()
+	mfs.mu.Lock()
+	defer mfs.mu.Unlock()
+
+	node, err := mfs.open(name, flag, perm)
+	if err != nil {
+		return nil, &fs.PathError{Op: "open", Path: name, Err: err}
+	}
+	// NewFile isn't overridden, it makes valid os.File, which is only used as a key
+	f := os.NewFile(mfs.nextFd, name)
+	mfs.nextFd++
+	h := &memHandle{node: node, name: name, flag: flag}
+	if flag&os.O_APPEND != 0 {
+		h.offset = int64(len(node.data))
+	}
+	mfs.files[f] = h
+
+	return f, nil
+}
+
+func fakeReadFile(name string) ([]byte, error) {
+	mfs := activeFS.Load()
+	mfs.mu.Lock()
+	node, _, _, err := mfs.lookup(name, false)
+	if err == nil && node == nil {
+		err = fs.ErrNotExist
+	}
+	if err == nil && node.children != nil {
+		err = syscall.EISDIR
+	}
+	if err != nil {
+		mfs.mu.Unlock()
+		return nil, &fs.PathError{Op: "open", Path: name, Err: err}
+	}
+	data, gen := node.data, node.gen
+	node.readers++
+	mfs.mu.Unlock()
+
+	// content is reallocated, when it is written while it is being read, so it can be copied
+	// without holding the lock
+	res := append([]byte(nil), data...)
+
+	mfs.mu.Lock()
+	if node.gen == gen {
+		node.readers--
+	}
+	mfs.mu.Unlock()
+
+	return res, nil
+}
+
+func fakeWriteFile(name string, data []byte, perm fs.FileMode) error {
+	mfs := activeFS.Load()
+	mfs.mu.Lock()
+	defer mfs.mu.Unlock()
+
+	node, err := mfs.open(name, os.O_WRONLY|os.O_CREATE|os.O_TRUNC, perm)
+	if err != nil {
+		return &fs.PathError{Op: "open", Path: name, Err: err}
+	}
+	node.write(data, 0)
+
+	return nil
+}
+
+func fakeStat(name string) (fs.FileInfo, error) {
+	mfs := activeFS.Load()
+	mfs.mu.Lock()
+	defer mfs.mu.Unlock()
+
+	node, _, _, err := mfs.lookup(name, false)
+	if err == nil && node == nil {
+		err = fs.ErrNotExist
+	}
+	if err != nil {
+		return nil, &fs.PathError{Op: "stat", Path: name, Err: err}
+	}
+
+	return node.info(), nil
+}
+
+// handle returns in-memory file handle for <f>, or nil if <f> is a real file
+func (mfs *memFS) handle(f *os.File) *memHandle {
+	mfs.mu.Lock()
+	defer mfs.mu.Unlock()
+
+	return mfs.files[f]
+}
+
+func fakeFileRead(f *os.File, b []byte) (n int, err error) {
+	mfs := activeFS.Load()
+	h := mfs.handle(f)
+	if h == nil {
+		original(mfs.fileRead, func(read func(*os.File, []byte) (int, error)) { n, err = read(f, b) })
+		return n, err
+	}
+
+	mfs.mu.Lock()
+	switch {
+	case h.closed:
+		err = os.ErrClosed
+	case h.node.children != nil:
+		err = syscall.EISDIR
+	case h.flag&os.O_WRONLY != 0:
+		err = syscall.EBADF
+	}
+	if err != nil {
+		mfs.mu.Unlock()
+		return 0, &fs.PathError{Op: "read", Path: h.name, Err: err}
+	}
+	data := h.node.data
+	offset := h.offset
+	if offset >= int64(len(data)) {
+		mfs.mu.Unlock()
+		if len(b) == 0 {
+			return 0, nil
+		}
+		return 0, io.EOF
+	}
+	n = copy(b, data[offset:])
+	h.offset += int64(n)
+	mfs.mu.Unlock()
+
+	return n, nil
+}
+
+func fakeFileWrite(f *os.File, b []byte) (n int, err error) {
+	mfs := activeFS.Load()
+	h := mfs.handle(f)
+	if h == nil {
+		original(mfs.fileWrite, func(write func(*os.File, []byte) (int, error)) { n, err = write(f, b) })
+		return n, err
+	}
+
+	mfs.mu.Lock()
+	defer mfs.mu.Unlock()
+	if h.closed {
+		return 0, &fs.PathError{Op: "write", Path: h.name, Err: os.ErrClosed}
+	}
+	if h.flag&(os.O_WRONLY|os.O_RDWR) == 0 {
+		return 0, &fs.PathError{Op: "write", Path: h.name, Err: syscall.EBADF}
+	}
+	if h.flag&os.O_APPEND != 0 {
+		h.offset = int64(len(h.node.data))
+	}
+	h.node.write(b, h.offset)
+	h.offset += int64(len(b))
+
+	return len(b), nil
+}
+
+func fakeFileClose(f *os.File) (err error) {
+	mfs := activeFS.Load()
+	h := mfs.handle(f)
+	if h == nil {
+		original(mfs.fileClose, func(close func(*os.File) error) { err = close(f) })
+		return err
+	}
+
+	mfs.mu.Lock()
+	if h.closed {
+		mfs.mu.Unlock()
+		return &fs.PathError{Op: "close", Path: h.name, Err: os.ErrClosed}
+	}
+	h.closed = true
+	delete(mfs.files, f)
+	mfs.mu.Unlock()
+
+	// close the real file too, so it reports being closed on further calls, and it isn't closed
+	// by finalizer. Its descriptor isn't valid, so error is ignored
+	original(mfs.fileClose, func(close func(*os.File) error) { close(f) })
+
+	return nil
+}
+
+func fakeFileStat(f *os.File) (fi fs.FileInfo, err error) {
+	mfs := activeFS.Load()
+	h := mfs.handle(f)
+	if h == nil {
+		original(mfs.fileStat, func(stat func(*os.File) (os.FileInfo, error)) { fi, err = stat(f) })
+		return fi, err
+	}
+
+	mfs.mu.Lock()
+	defer mfs.mu.Unlock()
+	if h.closed {
+		return nil, &fs.PathError{Op: "stat", Path: h.name, Err: os.ErrClosed}
+	}
+
+	return h.node.info(), nil
+}
@@ -0,0 +1,153 @@
+package testaroli
+
+import (
+	"errors"
+	"io"
+	"io/fs"
+	"os"
+	"testing"
+)
+
+func TestFSWriteReadFile(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	testError(t, nil, os.WriteFile("/no/such/dir/test.file", []byte("foo"), 0600))
+	data, err := os.ReadFile("/no/such/dir/test.file")
+	testError(t, nil, err)
+	if string(data) != "foo" {
+		t.Errorf("unexpected file content %s", string(data))
+	}
+
+	fi, err := os.Stat("/no/such/dir")
+	testError(t, nil, err)
+	if !fi.IsDir() {
+		t.Errorf("directory wasn't created")
+	}
+}
+
+func TestFSOpen(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	f, err := os.Create("test.file")
+	testError(t, nil, err)
+	n, err := f.Write([]byte("foobar"))
+	testError(t, nil, err)
+	if n != 6 {
+		t.Errorf("unexpected number of bytes written %d", n)
+	}
+	testError(t, nil, f.Close())
+
+	f, err = os.Open("test.file")
+	testError(t, nil, err)
+	defer f.Close()
+	fi, err := f.Stat()
+	testError(t, nil, err)
+	if fi.Size() != 6 || fi.Name() != "test.file" {
+		t.Errorf("unexpected file info %s %d", fi.Name(), fi.Size())
+	}
+	buf := make([]byte, 4)
+	n, err = f.Read(buf)
+	testError(t, nil, err)
+	if n != 4 || string(buf) != "foob" {
+		t.Errorf("unexpected file content %s", string(buf[:n]))
+	}
+	rest, err := io.ReadAll(f)
+	testError(t, nil, err)
+	if string(rest) != "ar" {
+		t.Errorf("unexpected file content %s", string(rest))
+	}
+	if _, err = f.Write([]byte("baz")); err == nil {
+		t.Errorf("file opened for reading is writable")
+	}
+}
+
+func TestFSAppend(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	testError(t, nil, os.WriteFile("test.file", []byte("foo"), 0600))
+	f, err := os.OpenFile("test.file", os.O_WRONLY|os.O_APPEND, 0)
+	testError(t, nil, err)
+	_, err = f.Write([]byte("bar"))
+	testError(t, nil, err)
+	testError(t, nil, f.Close())
+
+	data, _ := os.ReadFile("test.file")
+	if string(data) != "foobar" {
+		t.Errorf("unexpected file content %s", string(data))
+	}
+}
+
+func TestFSManyWrites(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	f, err := os.Create("test.file")
+	testError(t, nil, err)
+	for i := 0; i < 1<<16; i++ {
+		if _, err := f.Write([]byte{byte(i)}); err != nil {
+			t.Fatal(err)
+		}
+	}
+	testError(t, nil, f.Close())
+
+	data, err := os.ReadFile("test.file")
+	testError(t, nil, err)
+	if len(data) != 1<<16 || data[1<<15+1] != 1 {
+		t.Errorf("unexpected file content, size %d", len(data))
+	}
+}
+
+func TestFSClose(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	f, err := os.Create("test.file")
+	testError(t, nil, err)
+	testError(t, nil, f.Close())
+
+	if n := len(activeFS.Load().files); n != 0 {
+		t.Errorf("%d handles left after close", n)
+	}
+	if _, err := f.Write([]byte("foo")); !errors.Is(err, os.ErrClosed) {
+		t.Errorf("unexpected error %v", err)
+	}
+	if err := f.Close(); !errors.Is(err, os.ErrClosed) {
+		t.Errorf("unexpected error %v", err)
+	}
+}
+
+func TestFSNotExist(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	_, err := os.Open("test.file")
+	if !errors.Is(err, fs.ErrNotExist) {
+		t.Errorf("unexpected error %v", err)
+	}
+	_, err = os.ReadFile("test.file")
+	if !errors.Is(err, fs.ErrNotExist) {
+		t.Errorf("unexpected error %v", err)
+	}
+}
+
+func TestFSRealFile(t *testing.T) {
+	FakeFS(TestingContext(t))
+
+	// os.Stdout is a real file, so it should be written to
+	if _, err := os.Stdout.Write(nil); err != nil {
+		t.Error(err)
+	}
+	if _, err := os.Stdout.Stat(); err != nil {
+		t.Error(err)
+	}
+}
+
+func TestFSRestore(t *testing.T) {
+	t.Run("in-memory", func(t *testing.T) {
+		FakeFS(TestingContext(t))
+		testError(t, nil, os.WriteFile("memfs_test.go", []byte("foo"), 0600))
+	})
+
+	data, err := os.ReadFile("memfs_test.go")
+	testError(t, nil, err)
+	if string(data) == "foo" {
+		t.Error("real file was overwritten")
+	}
+}
@@ -0,0 +1,295 @@
+package testaroli
+
+import (
+	"context"
+	"net"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"time"
+)
+
+/*
+Network is in-memory network, which replaces the real one for the duration of the test.
+See [FakeNet] for details.
+*/
+type Network struct {
+	mu        sync.Mutex
+	listeners map[string]*memListener
+	nextPort  int
+	bandwidth atomic.Int64
+	patches   []*patch
+}
+
+type memListener struct {
+	net    *Network
+	key    string
+	addr   net.Addr
+	conns  chan net.Conn
+	done   chan struct{}
+	closed sync.Once
+}
+
+type memConn struct {
+	net.Conn
+	net    *Network
+	local  net.Addr
+	remote net.Addr
+}
+
+// size of the queue of connections, not accepted yet
+const memBacklog = 1024
+
+// range of ephemeral ports, allocated for listeners on port 0 and for client ends of connections
+const (
+	memFirstPort = 32768
+	memLastPort  = 65535
+)
+
+var activeNet atomic.Pointer[Network]
+
+/*
+FakeNet overrides [net.Dialer.DialContext] and [net.ListenConfig.Listen] to use in-memory
+connections instead of real sockets. [net.Dial], [net.DialTimeout] and [net.Listen] use
+overridden methods internally, so they use in-memory network too, as well as
+[net/http] clients and servers with default transport.
+
+Only stream networks are supported - "tcp", "tcp4", "tcp6" and "unix". For TCP networks
+host part of the address is ignored, so connection to any host succeeds if there is a
+listener on the requested port. Listening on port 0 allocates unique port, as with real network.
+Connections are synchronous pipes, created with [net.Pipe], so they have no internal
+buffering, and they aren't [net.TCPConn].
+
+	func TestClient(t *testing.T) {
+	    FakeNet(TestingContext(t))
+
+	    l, _ := net.Listen("tcp", "localhost:0")
+	    go serve(l)
+	    client := NewClient(l.Addr().String())
+	    ...
+	}
+
+Original methods are restored when test, which context is passed to FakeNet, completes.
+Only one in-memory network can be active at any time. Like with [Override], it is necessary
+to disable function inlining to make FakeNet work.
+*/
+func FakeNet(ctx context.Context) *Network {
+	t := Testing(ctx)
+
+	n := &Network{
+		listeners: map[string]*memListener{},
+		nextPort:  memFirstPort,
+	}
+	if !activeNet.CompareAndSwap(nil, n) {
+		panic("In-memory network is already active")
+	}
+
+	n.patches = []*patch{
+		newPatch((*net.Dialer).DialContext, fakeDialContext),
+		newPatch((*net.ListenConfig).Listen, fakeListen),
+	}
+
+	t.Cleanup(n.restore)
+
+	return n
+}
+
+/*
+SetBandwidth limits the speed of writes to any connection of the network to <bytesPerSec>.
+Zero value (default) means unlimited bandwidth.
+*/
+func (n *Network) SetBandwidth(bytesPerSec int) {
+	n.bandwidth.Store(int64(bytesPerSec))
+}
+
+func (n *Network) restore() {
+	for _, p := range n.patches {
+		p.remove()
+	}
+	activeNet.Store(nil)
+
+	n.mu.Lock()
+	defer n.mu.Unlock()
+	for _, l := range n.listeners {
+		l.closed.Do(func() { close(l.done) })
+	}
+}
+
+// port returns ephemeral port number, which isn't used by any listener
+func (n *Network) port() (int, error) {
+	for i := memFirstPort; i <= memLastPort; i++ {
+		port := n.nextPort
+		n.nextPort++
+		if n.nextPort > memLastPort {
+			n.nextPort = memFirstPort
+		}
+		if _, ok := n.listeners["tcp:"+strconv.Itoa(port)]; !ok {
+			return port, nil
+		}
+	}
+
+	return 0, syscall.EADDRNOTAVAIL
+}
+
+// resolve returns listener key and address for <address>
+func (n *Network) resolve(network, address string, listen bool) (string, net.Addr, error) {
+	switch network {
+	case "tcp", "tcp4", "tcp6":
+		host, portStr, err := net.SplitHostPort(address)
+		if err != nil {
+			return "", nil, err
+		}
+		port, err := strconv.Atoi(portStr)
+		if err != nil || port < 0 || port > 65535 {
+			return "", nil, &net.AddrError{Err: "invalid port", Addr: address}
+		}
+		if port == 0 && listen {
+			if port, err = n.port(); err != nil {
+				return "", nil, err
+			}
+		}
+		ip := net.ParseIP(host)
+		if ip == nil {
+			ip = net.IPv4(127, 0, 0, 1)
+		}
+		return "tcp:" + strconv.Itoa(port), &net.TCPAddr{IP: ip, Port: port}, nil
+	case "unix":
+		return "unix:" + address, &net.UnixAddr{Name: address, Net: network}, nil
+	}
+
+	return "", nil, net.UnknownNetworkError(network)
+}
+
+// Mocks below are plain functions, not closures, because mock is executed in the scope of
+// original function, so they find network through the package-level variable.
+
+func fakeListen(lc *net.ListenConfig, ctx context.Context, network, address string) (net.Listener, error) {
+	n := activeNet.Load()
+	n.mu.Lock()
+	defer n.mu.Unlock()
+
+	key, addr, err := n.resolve(network, address, true)
+	if err != nil {
+		return nil, &net.OpError{Op: "listen", Net: network, Err: err}
+	}
+	if _, ok := n.listeners[key]; ok {
+		return nil, &net.OpError{Op: "listen", Net: network, Addr: addr, Err: syscall.EADDRINUSE}
+	}
+	l := &memListener{
+		net:   n,
+		key:   key,
+		addr:  addr,
+		conns: make(chan net.Conn, memBacklog),
+		done:  make(chan struct{}),
+	}
+	n.listeners[key] = l
+
+	return l, nil
+}
+
+func fakeDialContext(d *net.Dialer, ctx context.Context, network, address string) (net.Conn, error) {
+	n := activeNet.Load()
+	n.mu.Lock()
+	key, addr, err := n.resolve(network, address, false)
+	if err != nil {
+		n.mu.Unlock()
+		return nil, &net.OpError{Op: "dial", Net: network, Err: err}
+	}
+	l, ok := n.listeners[key]
+	var local net.Addr = &net.UnixAddr{Net: network}
+	if tcpAddr, isTCP := addr.(*net.TCPAddr); isTCP {
+		port, err := n.port()
+		if err != nil {
+			n.mu.Unlock()
+			return nil, &net.OpError{Op: "dial", Net: network, Addr: addr, Err: err}
+		}
+		local = &net.TCPAddr{IP: tcpAddr.IP, Port: port}
+	}
+	n.mu.Unlock()
+	if !ok {
+		return nil, &net.OpError{Op: "dial", Net: network, Addr: addr, Err: syscall.ECONNREFUSED}
+	}
+
+	client, server := net.Pipe()
+	select {
+	case l.conns <- &memConn{Conn: server, net: n, local: l.addr, remote: local}:
+		return &memConn{Conn: client, net: n, local: local, remote: l.addr}, nil
+	case <-l.done:
+		err = syscall.ECONNREFUSED
+	case <-ctx.Done():
+		err = ctx.Err()
+	}
+	client.Close()
+	server.Close()
+
+	return nil, &net.OpError{Op: "dial", Net: network, Addr: addr, Err: err}
+}
+
+func (l *memListener) Accept() (net.Conn, error) {
+	select {
+	case c := <-l.conns:
+		return c, nil
+	case <-l.done:
+		return nil, &net.OpError{Op: "accept", Net: l.addr.Network(), Addr: l.addr, Err: net.ErrClosed}
+	}
+}
+
+func (l *memListener) Close() error {
+	l.net.mu.Lock()
+	defer l.net.mu.Unlock()
+
+	if l.net.listeners[l.key] == l {
+		delete(l.net.listeners, l.key)
+	}
+	l.closed.Do(func() { close(l.done) })
+	// reset connections, which weren't accepted
+	for {
+		select {
+		case c := <-l.conns:
+			c.Close()
+		default:
+			return nil
+		}
+	}
+}
+
+func (l *memListener) Addr() net.Addr {
+	return l.addr
+}
+
+func (c *memConn) Write(b []byte) (int, error) {
+	bandwidth := c.net.bandwidth.Load()
+	if bandwidth <= 0 {
+		return c.Conn.Write(b)
+	}
+
+	// write in chunks, which take at most 10ms each at given bandwidth
+	chunk := int(bandwidth / 100)
+	if chunk == 0 {
+		chunk = 1
+	}
+	written := 0
+	for written < len(b) {
+		end := written + chunk
+		if end > len(b) {
+			end = len(b)
+		}
+		n, err := c.Conn.Write(b[written:end])
+		written += n
+		if err != nil {
+			return written, err
+		}
+		time.Sleep(time.Duration(int64(n) * int64(time.Second) / bandwidth))
+	}
+
+	return written, nil
+}
+
+func (c *memConn) LocalAddr() net.Addr {
+	return c.local
+}
+
+func (c *memConn) RemoteAddr() net.Addr {
+	return c.remote
+}
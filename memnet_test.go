@@ -0,0 +1,167 @@
+package testaroli
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"net/http"
+	"net/http/httptest"
+	"sync"
+	"syscall"
+	"testing"
+	"time"
+)
+
+func TestNetEcho(t *testing.T) {
+	FakeNet(TestingContext(t))
+
+	l, err := net.Listen("tcp", "localhost:0")
+	testError(t, nil, err)
+	defer l.Close()
+	go func() {
+		for {
+			c, err := l.Accept()
+			if err != nil {
+				return
+			}
+			go func() {
+				defer c.Close()
+				io.Copy(c, c)
+			}()
+		}
+	}()
+
+	c, err := net.Dial("tcp", l.Addr().String())
+	testError(t, nil, err)
+	defer c.Close()
+	if _, err := c.Write([]byte("foo")); err != nil {
+		t.Error(err)
+	}
+	buf := make([]byte, 3)
+	if _, err := io.ReadFull(c, buf); err != nil || string(buf) != "foo" {
+		t.Errorf("unexpected echo %s (%v)", string(buf), err)
+	}
+	if c.RemoteAddr().String() != l.Addr().String() {
+		t.Errorf("unexpected remote address %s", c.RemoteAddr())
+	}
+}
+
+func TestNetManyConns(t *testing.T) {
+	FakeNet(TestingContext(t))
+
+	l, err := net.Listen("tcp", ":8080")
+	testError(t, nil, err)
+	defer l.Close()
+	go func() {
+		for {
+			c, err := l.Accept()
+			if err != nil {
+				return
+			}
+			go func() {
+				defer c.Close()
+				io.Copy(c, c)
+			}()
+		}
+	}()
+
+	var wg sync.WaitGroup
+	for i := 0; i < 2000; i++ {
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			c, err := net.Dial("tcp", "127.0.0.1:8080")
+			if err != nil {
+				t.Error(err)
+				return
+			}
+			defer c.Close()
+			msg := fmt.Sprintf("%08d", i)
+			c.Write([]byte(msg))
+			buf := make([]byte, len(msg))
+			if _, err := io.ReadFull(c, buf); err != nil || string(buf) != msg {
+				t.Errorf("unexpected echo %s (%v)", string(buf), err)
+			}
+		}(i)
+	}
+	wg.Wait()
+}
+
+func TestNetHTTP(t *testing.T) {
+	FakeNet(TestingContext(t))
+
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		w.Write([]byte("foo"))
+	}))
+	defer srv.Close()
+
+	resp, err := http.Get(srv.URL)
+	testError(t, nil, err)
+	defer resp.Body.Close()
+	body, _ := io.ReadAll(resp.Body)
+	if string(body) != "foo" {
+		t.Errorf("unexpected response %s", string(body))
+	}
+}
+
+func TestNetRefused(t *testing.T) {
+	FakeNet(TestingContext(t))
+
+	_, err := net.Dial("tcp", "localhost:1")
+	if !errors.Is(err, syscall.ECONNREFUSED) {
+		t.Errorf("unexpected error %v", err)
+	}
+
+	l, err := net.Listen("unix", "/tmp/test.sock")
+	testError(t, nil, err)
+	if _, err = net.Listen("unix", "/tmp/test.sock"); !errors.Is(err, syscall.EADDRINUSE) {
+		t.Errorf("unexpected error %v", err)
+	}
+	l.Close()
+	if _, err := l.Accept(); !errors.Is(err, net.ErrClosed) {
+		t.Errorf("unexpected error %v", err)
+	}
+}
+
+func TestNetPortWrap(t *testing.T) {
+	n := FakeNet(TestingContext(t))
+
+	l, err := net.Listen("tcp", fmt.Sprintf(":%d", memFirstPort))
+	testError(t, nil, err)
+	defer l.Close()
+	n.nextPort = memLastPort
+	for _, expected := range []int{memLastPort, memFirstPort + 1} {
+		l, err := net.Listen("tcp", ":0")
+		testError(t, nil, err)
+		if port := l.Addr().(*net.TCPAddr).Port; port != expected {
+			t.Errorf("unexpected port %d, expected %d", port, expected)
+		}
+		defer l.Close()
+	}
+}
+
+func TestNetBandwidth(t *testing.T) {
+	n := FakeNet(TestingContext(t))
+	clock := FakeClock(TestingContext(t))
+	n.SetBandwidth(1000)
+
+	l, err := net.Listen("tcp", ":0")
+	testError(t, nil, err)
+	defer l.Close()
+	go func() {
+		c, err := l.Accept()
+		if err == nil {
+			io.Copy(io.Discard, c)
+		}
+	}()
+
+	c, err := net.Dial("tcp", l.Addr().String())
+	testError(t, nil, err)
+	defer c.Close()
+	start := clock.Now()
+	c.Write(make([]byte, 2000))
+	if d := clock.Now().Sub(start); d != 2*time.Second {
+		t.Errorf("unexpected transfer time %v", d)
+	}
+}
@@ -0,0 +1,361 @@
+package testaroli
+
+import (
+	"container/list"
+	"context"
+	"encoding/binary"
+	"hash/maphash"
+	"math"
+	"reflect"
+	"sync"
+	"sync/atomic"
+	"unsafe"
+)
+
+/*
+MemoizeCacheSize is the max number of calls, which results are cached by [Memoize] for each
+function, least recently used results are evicted when cache is full.
+*/
+var MemoizeCacheSize = 1024
+
+// pointers are followed up to this depth when hashing, deeper values are compared only
+const memoHashDepth = 8
+
+/*
+Memo counts the calls of memoized function, see [Memoize] for details.
+*/
+type Memo struct {
+	mu      sync.Mutex
+	seed    maphash.Seed
+	size    int
+	entries map[uint64][]*list.Element // hash of args -> entries
+	lru     list.List                  // of *memoEntry, most recently used first
+	hits    atomic.Int64
+	misses  atomic.Int64
+}
+
+type memoEntry struct {
+	hash    uint64
+	args    []reflect.Value
+	results []reflect.Value
+}
+
+/*
+Memoize patches deterministic function <fn> to return cached results when it is called
+again with the arguments, equal to the ones of the previous call. It allows to cut the
+time, spent in expensive functions, like parsers or key derivation, which tests call many
+times with the same input, without changing the code under test:
+
+	func TestHandlers(t *testing.T) {
+	    Memoize(TestingContext(t), deriveKey)
+	    ...
+	}
+
+Arguments are compared like with [Expect.CheckArgs], so pointers, slices and maps are
+compared by the values they point to, and registered comparators and Equal methods are
+used. Arguments are copied deeply when stored in the cache, so changing them after the call
+doesn't change the cache. Cached results are copied for every call, except the values they
+point to, which are shared, so pointers, like sentinel errors, keep their identity. Function
+must not have side effects, or its effects happen only on the first call, and its arguments
+must not contain values, which can't be copied, like mutexes.
+
+Cache holds up to [MemoizeCacheSize] results. Calls, not served from the cache, go to the
+original function through the trampoline, so they run in parallel, and recursive calls are
+memoized too. Original function is restored when test, which context is passed to Memoize,
+completes. Like with [Override], it is necessary to disable function inlining to
+make Memoize work.
+*/
+func Memoize(ctx context.Context, fn any) *Memo {
+	t := Testing(ctx)
+
+	m := &Memo{
+		seed:    maphash.MakeSeed(),
+		size:    MemoizeCacheSize,
+		entries: map[uint64][]*list.Element{},
+	}
+	p := newHook(fn, func(p *patch, args []reflect.Value) []reflect.Value {
+		hash := m.hash(args)
+		if results, ok := m.get(hash, args); ok {
+			m.hits.Add(1)
+			return results
+		}
+		m.misses.Add(1)
+
+		results := p.call(args)
+		m.put(hash, args, results)
+
+		return results
+	})
+
+	t.Cleanup(p.remove)
+
+	return m
+}
+
+/*
+Hits returns the number of calls, served from the cache.
+*/
+func (m *Memo) Hits() int {
+	return int(m.hits.Load())
+}
+
+/*
+Misses returns the number of calls of the original function.
+*/
+func (m *Memo) Misses() int {
+	return int(m.misses.Load())
+}
+
+// get returns copy of the cached results for <args>
+func (m *Memo) get(hash uint64, args []reflect.Value) ([]reflect.Value, bool) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	elem := m.find(hash, args)
+	if elem == nil {
+		return nil, false
+	}
+	m.lru.MoveToFront(elem)
+
+	return cloneValues(elem.Value.(*memoEntry).results, false), true
+}
+
+// put caches copy of the <results> for <args>, evicting least recently used entry, if cache is full
+func (m *Memo) put(hash uint64, args, results []reflect.Value) {
+	if m.size <= 0 {
+		return
+	}
+	entry := &memoEntry{hash: hash, args: cloneValues(args, true), results: cloneValues(results, false)}
+
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	if m.find(hash, args) != nil {
+		return // cached by concurrent call
+	}
+	if m.lru.Len() >= m.size {
+		oldest := m.lru.Remove(m.lru.Back()).(*memoEntry)
+		bucket := m.entries[oldest.hash]
+		for i, elem := range bucket {
+			if elem.Value == oldest {
+				bucket = append(bucket[:i], bucket[i+1:]...)
+				break
+			}
+		}
+		if len(bucket) == 0 {
+			delete(m.entries, oldest.hash)
+		} else {
+			m.entries[oldest.hash] = bucket
+		}
+	}
+	m.entries[hash] = append(m.entries[hash], m.lru.PushFront(entry))
+}
+
+// find returns the cache entry for <args>, must be called with m.mu locked
+func (m *Memo) find(hash uint64, args []reflect.Value) *list.Element {
+	for _, elem := range m.entries[hash] {
+		if sameArgs(elem.Value.(*memoEntry).args, args) {
+			return elem
+		}
+	}
+
+	return nil
+}
+
+func sameArgs(cached, args []reflect.Value) bool {
+	for i := range args {
+		if (comparer{}).compare(addressable(cached[i]), addressable(args[i])) != nil {
+			return false
+		}
+	}
+
+	return true
+}
+
+// hash returns the hash of <args>, which is the same for arguments, equal by [equal]
+func (m *Memo) hash(args []reflect.Value) uint64 {
+	var h maphash.Hash
+	h.SetSeed(m.seed)
+	for _, arg := range args {
+		m.hashValue(&h, arg, 0)
+	}
+
+	return h.Sum64()
+}
+
+func (m *Memo) hashValue(h *maphash.Hash, v reflect.Value, depth int) {
+	if v.Kind() == reflect.Interface {
+		v = v.Elem()
+	}
+	if !v.IsValid() {
+		h.WriteByte(0)
+		return
+	}
+	// values with comparators can be equal whatever their content is
+	if comparatorFor(v.Type()) != nil {
+		h.WriteString(v.Type().String())
+		return
+	}
+
+	var buf [8]byte
+	writeUint := func(u uint64) {
+		binary.LittleEndian.PutUint64(buf[:], u)
+		h.Write(buf[:])
+	}
+	writeFloat := func(f float64) {
+		switch {
+		case f == 0:
+			f = 0 // -0 equals 0
+		case math.IsNaN(f):
+			f = math.NaN() // NaNs are equal
+		}
+		writeUint(math.Float64bits(f))
+	}
+
+	switch v.Kind() {
+	case reflect.Bool:
+		if v.Bool() {
+			h.WriteByte(1)
+		} else {
+			h.WriteByte(0)
+		}
+	case reflect.Int, reflect.Int8, reflect.Int16, reflect.Int32, reflect.Int64:
+		writeUint(uint64(v.Int()))
+	case reflect.Uint, reflect.Uint8, reflect.Uint16, reflect.Uint32, reflect.Uint64, reflect.Uintptr:
+		writeUint(v.Uint())
+	case reflect.Float32, reflect.Float64:
+		writeFloat(v.Float())
+	case reflect.Complex64, reflect.Complex128:
+		writeFloat(real(v.Complex()))
+		writeFloat(imag(v.Complex()))
+	case reflect.String:
+		h.WriteString(v.String())
+	case reflect.Chan, reflect.Func, reflect.UnsafePointer:
+		writeUint(uint64(v.Pointer()))
+	case reflect.Pointer:
+		if !v.IsNil() && depth < memoHashDepth {
+			m.hashValue(h, v.Elem(), depth+1)
+		}
+	case reflect.Array, reflect.Slice:
+		writeUint(uint64(v.Len()))
+		if v.Kind() == reflect.Slice && v.Type().Elem().Kind() == reflect.Uint8 {
+			h.Write(v.Bytes())
+			return
+		}
+		for i := 0; i < v.Len(); i++ {
+			m.hashValue(h, v.Index(i), depth)
+		}
+	case reflect.Struct:
+		for i := 0; i < v.NumField(); i++ {
+			m.hashValue(h, v.Field(i), depth)
+		}
+	case reflect.Map:
+		// map order is random, so entry hashes are combined with commutative operation
+		writeUint(uint64(v.Len()))
+		var sum uint64
+		iter := v.MapRange()
+		for iter.Next() {
+			var eh maphash.Hash
+			eh.SetSeed(m.seed)
+			m.hashValue(&eh, iter.Key(), depth)
+			m.hashValue(&eh, iter.Value(), depth)
+			sum += eh.Sum64()
+		}
+		writeUint(sum)
+	}
+}
+
+/*
+cloneValues returns deep copies of <values>. Arguments are compared by the values they point
+to, so they are copied with <pointers>, while pointers in results are kept, so results can
+be compared by identity, e.g. with [errors.Is].
+*/
+func cloneValues(values []reflect.Value, pointers bool) []reflect.Value {
+	clones := make([]reflect.Value, len(values))
+	c := cloner{pointers: pointers, seen: map[unsafe.Pointer]reflect.Value{}}
+	for i, v := range values {
+		clones[i] = c.clone(v)
+	}
+
+	return clones
+}
+
+type cloner struct {
+	pointers bool                             // whether values, pointed to, are copied
+	seen     map[unsafe.Pointer]reflect.Value // already copied pointers and maps
+}
+
+/*
+clone returns deep copy of <v>, pointers and maps, already copied, are taken from seen, so
+copy has the same shape as original value, even if it has cycles.
+*/
+func (cl cloner) clone(v reflect.Value) reflect.Value {
+	switch v.Kind() {
+	case reflect.Pointer:
+		if v.IsNil() || !cl.pointers {
+			return v
+		}
+		if c, ok := cl.seen[v.UnsafePointer()]; ok {
+			return c
+		}
+		c := reflect.New(v.Type().Elem())
+		cl.seen[v.UnsafePointer()] = c
+		c.Elem().Set(cl.clone(v.Elem()))
+		return c
+	case reflect.Slice:
+		if v.IsNil() {
+			return v
+		}
+		c := reflect.MakeSlice(v.Type(), v.Len(), v.Len())
+		if isScalar(v.Type().Elem().Kind()) {
+			reflect.Copy(c, v)
+			return c
+		}
+		for i := 0; i < v.Len(); i++ {
+			c.Index(i).Set(cl.clone(v.Index(i)))
+		}
+		return c
+	case reflect.Map:
+		if v.IsNil() {
+			return v
+		}
+		if c, ok := cl.seen[v.UnsafePointer()]; ok {
+			return c
+		}
+		c := reflect.MakeMapWithSize(v.Type(), v.Len())
+		cl.seen[v.UnsafePointer()] = c
+		iter := v.MapRange()
+		for iter.Next() {
+			c.SetMapIndex(cl.clone(iter.Key()), cl.clone(iter.Value()))
+		}
+		return c
+	case reflect.Interface:
+		if v.IsNil() {
+			return v
+		}
+		c := reflect.New(v.Type()).Elem()
+		c.Set(cl.clone(v.Elem()))
+		return c
+	case reflect.Array, reflect.Struct:
+		c := reflect.New(v.Type()).Elem()
+		c.Set(v)
+		if v.Kind() == reflect.Array {
+			for i := 0; i < c.Len(); i++ {
+				c.Index(i).Set(cl.clone(c.Index(i)))
+			}
+		} else {
+			for i := 0; i < c.NumField(); i++ {
+				// fields of addressable copy can be set, even unexported ones
+				f := accessible(c.Field(i))
+				f.Set(cl.clone(f))
+			}
+		}
+		return c
+	}
+
+	return v // values of other kinds are immutable or can't be copied
+}
+
+func isScalar(kind reflect.Kind) bool {
+	return kind >= reflect.Bool && kind <= reflect.Complex128 || kind == reflect.String
+}
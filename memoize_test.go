@@ -0,0 +1,86 @@
+package testaroli
+
+import (
+	"errors"
+	"math"
+	"reflect"
+	"strings"
+	"testing"
+)
+
+var errParse = errors.New("parse error")
+
+type parsed struct {
+	fields []string
+	attrs  map[string]float64
+}
+
+func parse(input []byte, sep string, attrs map[string]float64) (*parsed, []string, error) {
+	if len(input) == 0 {
+		return nil, nil, errParse
+	}
+	fields := strings.Split(string(input), sep)
+	return &parsed{fields: fields, attrs: attrs}, fields, nil
+}
+
+func TestMemoize(t *testing.T) {
+	memo := Memoize(TestingContext(t), parse)
+
+	input := []byte("a,b")
+	attrs := map[string]float64{"x": 1, "nan": math.NaN()}
+	p1, f1, err := parse(input, ",", attrs)
+	testError(t, nil, err)
+	f1[0] = "changed" // doesn't change cached result
+
+	// equal, but not the same args
+	p2, f2, err := parse([]byte("a,b"), ",", map[string]float64{"nan": math.NaN(), "x": 1})
+	testError(t, nil, err)
+	if f2[0] != "a" || p1 != p2 { // values, pointed to, are shared
+		t.Errorf("unexpected result %v, %v", p2, f2)
+	}
+	if memo.Hits() != 1 || memo.Misses() != 1 {
+		t.Errorf("unexpected hits/misses %d/%d", memo.Hits(), memo.Misses())
+	}
+
+	input[0] = 'c' // doesn't change cached args
+	if _, f3, _ := parse(input, ",", attrs); f3[0] != "c" {
+		t.Errorf("unexpected result %v", f3)
+	}
+	if _, _, err := parse(nil, ",", nil); err != errParse {
+		t.Errorf("unexpected error %v", err)
+	}
+	if _, _, err := parse(nil, ",", nil); err != errParse { // pointer identity is kept
+		t.Errorf("unexpected error %v", err)
+	}
+	if memo.Hits() != 2 || memo.Misses() != 3 {
+		t.Errorf("unexpected hits/misses %d/%d", memo.Hits(), memo.Misses())
+	}
+}
+
+func TestMemoizeEviction(t *testing.T) {
+	defer func(size int) { MemoizeCacheSize = size }(MemoizeCacheSize)
+	MemoizeCacheSize = 2
+	memo := Memoize(TestingContext(t), parse)
+
+	for _, s := range []string{"a", "b", "a", "c", "a", "b"} {
+		parse([]byte(s), ",", nil)
+	}
+	// b is evicted by c, as a was used more recently
+	if memo.Hits() != 2 || memo.Misses() != 4 {
+		t.Errorf("unexpected hits/misses %d/%d", memo.Hits(), memo.Misses())
+	}
+}
+
+func TestCloneCycle(t *testing.T) {
+	type node struct {
+		next *node
+		vals []int
+	}
+	n := &node{vals: []int{1, 2}}
+	n.next = n
+
+	c := cloneValues([]reflect.Value{reflect.ValueOf(n)}, true)[0].Interface().(*node)
+	if c == n || c.next != c || &c.vals[0] == &n.vals[0] || c.vals[1] != 2 {
+		t.Errorf("unexpected clone %+v", c)
+	}
+}
@@ -83,7 +83,7 @@ import (
 	"context"
 	"fmt"
 	"reflect"
-	"runtime"
+	"sync"
 	"testing"
 )
 
@@ -95,7 +95,10 @@ const (
 	testingKey = contextKey(1)
 )
 
-var expectations []*Expect
+var (
+	expectations chain
+	chainMu      sync.RWMutex // protects expectations
+)
 
 /*
 Override overrides <org> with <mock>. The signatures of <org> and <mock> must match exactly,
@@ -108,7 +111,8 @@ can only be the last one in the chain of overrides.
 
 It is ok to call Override several times, however only the first override becomes immediately effecive,
 all subsequent overrides are placed in the chain and become effective only when previous override is
-completed. It means that order of overrides must match the order of called functions exactly. For example:
+completed. It means that order of overrides must match the order of called functions exactly, unless
+overrides are put into [Group]. For example:
 
 	// Function bar() will be overridden only after override for foo() is processed
 	Override(ctx, foo, Once, func (a int, b string) {
@@ -155,14 +159,18 @@ the variable from the context from within mock function, for example:
 	    // now 'val' is ok to use and contains the value 100
 	})
 
-You can override regular functions and methods, including standard ones, but not the interface methods.
+You can override regular functions and methods, including standard ones, but not the interface methods,
+use [OverrideInterface] for them.
 */
 func Override[T any](ctx context.Context, org T, count int, mock T) T {
 	if reflect.ValueOf(org).Kind() != reflect.Func || reflect.ValueOf(mock).Kind() != reflect.Func {
 		panic("Override() can be called only for function/method")
 	}
 
-	if len(expectations) > 0 && expectations[len(expectations)-1].expCount == Unlimited {
+	chainMu.Lock()
+	defer chainMu.Unlock()
+
+	if last := expectations.back(); last != nil && last.expCount == Unlimited {
 		panic("Cannot override the function because previous override in chain has unlimited number of repetitions, therefore this override is unreachable")
 	}
 
@@ -171,22 +179,44 @@ func Override[T any](ctx context.Context, org T, count int, mock T) T {
 	}
 
 	Testing(ctx) // just to make sure the context is correct
+	stats.overrides.Add(1)
+	if TrackAllocs {
+		defer excludeAllocs(readAllocs())
+	}
 
 	orgPointer := reflect.ValueOf(org).UnsafePointer()
 	mockPointer := reflect.ValueOf(mock).UnsafePointer()
 
-	expectedCall := Expect{
+	exp := Expect{
 		ctx:      ctx,
 		expCount: count,
 		mockAddr: mockPointer,
 		orgAddr:  orgPointer,
-		orgName:  runtime.FuncForPC(uintptr(orgPointer)).Name(),
+		orgName:  funcName(orgPointer),
 	}
+	checkGroup(exp)
+	checkNotPatched(orgPointer)
+
+	head := expectations.front()
+	expectedCall := expectations.push(exp)
+	addToGroup(expectedCall)
 
 	typ := reflect.ValueOf(org).Type()
+	// functions, too short for the jump to the wrapper, call the mock directly
+	if funcFits(orgPointer, closureJmpLength) {
+		expectedCall.wrapper = wrapMock(expectedCall, typ, reflect.ValueOf(mock))
+	}
+	var argsAllocated allocCount // by reflection, before the function below is called
+	if TrackAllocs {
+		argsAllocated = argsAllocs(typ)
+	}
 	v := reflect.MakeFunc(
 		typ,
 		func(args []reflect.Value) []reflect.Value {
+			if TrackAllocs {
+				// setting expected args is a part of Override
+				defer excludeAllocs(readAllocs().sub(argsAllocated))
+			}
 			expectedCall.args = args
 			ret := make([]reflect.Value, typ.NumOut())
 			for i := range ret {
@@ -199,36 +229,84 @@ func Override[T any](ctx context.Context, org T, count int, mock T) T {
 	fn := reflect.ValueOf(&expectedArgsFunc).Elem()
 	fn.Set(v)
 
-	if len(expectations) == 0 {
-		// first mock - change function prologue
-		expectedCall.orgPrologue = override(orgPointer, mockPointer) // call arch-specific function
+	if head == nil || (head.group != nil && head.group == expectedCall.group) {
+		// first mock, or mock in the group at the head of the chain - change function prologue
+		expectedCall.orgPrologue = expectedCall.install()
 	}
-	expectations = append(expectations, &expectedCall)
 
 	return expectedArgsFunc
 }
 
+// mockCall calls the mock with the arguments of the call of overridden function
+type mockCall func(args []reflect.Value) []reflect.Value
+
+/*
+wrapMock returns the function of type <typ>, which calls <mock>, tagging the goroutine with
+pprof labels, if [ProfileLabels] is set, and counting allocations of the mock, if [TrackAllocs]
+is set, or nil if mock doesn't need the wrapper.
+*/
+func wrapMock(e *Expect, typ reflect.Type, mock reflect.Value) any {
+	labels := profileLabels()
+	if !labels && !TrackAllocs {
+		return nil
+	}
+
+	call := mockCall(mock.Call)
+	if typ.IsVariadic() {
+		call = mock.CallSlice
+	}
+	if labels {
+		call = withLabels(e, call)
+	}
+	if TrackAllocs {
+		call = withAllocCount(typ, call)
+	}
+
+	return reflect.MakeFunc(typ, call).Interface()
+}
+
+// install overrides the function with the mock, or with the mock's wrapper, if there is one
+func (e *Expect) install() []byte {
+	if e.wrapper != nil {
+		return overrideClosure(e.orgAddr, closurePointer(e.wrapper)) // call arch-specific function
+	}
+
+	return override(e.orgAddr, e.mockAddr) // call arch-specific function
+}
+
 /*
 ExpectationsWereMet checks that all overridden functions were called, as expected.
 It doesn't check correct order of functions called (it is responsibility of [Expectation]) and
 it doesn't check function arguments (it is responsibility of [Expect.CheckArgs]).
 It is important to call ExpectationsWereMet at the end of test case to restore original state
-of overridden functions.
+of overridden functions. If overridden functions are called from background goroutines, use
+[WaitForCalls] to wait for the calls before calling ExpectationsWereMet.
 */
 func ExpectationsWereMet() error {
-	defer func() { expectations = nil }()
-
-	if len(expectations) != 0 {
-		if len(expectations[0].orgPrologue) > 0 {
+	endAllocWindow()
+	chainMu.Lock()
+	defer chainMu.Unlock()
+	defer chainAdvanced()
+	defer expectations.clear()
+
+	var notMet *Expect
+	for i := 0; i < headSize(); i++ {
+		e := expectations.at(i)
+		if e.met() {
+			continue // already reset
+		}
+		if len(e.orgPrologue) > 0 {
 			// reset last override
-			reset(expectations[0].orgAddr, expectations[0].orgPrologue)
+			reset(e.orgAddr, e.orgPrologue)
 		}
 		// special case - last expectation has unlimited number of repetitions, so it is not an error
-		if expectations[0].expCount == Unlimited {
-			return nil
+		if notMet == nil && e.expCount != Unlimited {
+			notMet = e
 		}
+	}
+	if notMet != nil {
 		return fmt.Errorf("some expectations weren't met - function %s was not called",
-			expectations[0].orgName)
+			notMet.orgName)
 	}
 
 	return nil
@@ -251,5 +329,8 @@ func Testing(ctx context.Context) *testing.T {
 		}
 	}()
 
-	return ctx.Value(testingKey).(*testing.T)
+	t := ctx.Value(testingKey).(*testing.T)
+	restoreAfter(t) // code, patched by the test, is writable until it completes
+
+	return t
 }
@@ -8,6 +8,11 @@ import (
 const jmpInstrLength = 5 // length of local JMP instruction with operand
 const jmpInstrCode = uint8(0xE9)
 
+// MOV RDX, <closure>; JMP [RDX] - RDX is the closure context register
+const closureJmpLength = 12
+
+var closureJmpCode = []byte{0x48, 0xBA, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0x22}
+
 func override(orgPointer, mockPointer unsafe.Pointer) []byte {
 	funcPrologue := unsafe.Slice((*uint8)(orgPointer), jmpInstrLength)
 	orgPrologue := make([]byte, jmpInstrLength)
@@ -19,11 +24,33 @@ func override(orgPointer, mockPointer unsafe.Pointer) []byte {
 	jumpLocation := uintptr(mockPointer) - (uintptr(orgPointer) + jmpInstrLength)
 	binary.NativeEndian.PutUint32(newPrologue[1:], uint32(jumpLocation))
 
+	if !samePrologue(orgPointer, newPrologue) {
+		replacePrologue(orgPointer, newPrologue) // OS-specific
+	}
+
+	return orgPrologue
+}
+
+// overrideClosure replaces function prologue with the jump to the closure, which can have
+// variables from enclosing scope, unlike mock installed with override()
+func overrideClosure(orgPointer, closure unsafe.Pointer) []byte {
+	checkFuncSize(orgPointer, closureJmpLength)
+
+	funcPrologue := unsafe.Slice((*uint8)(orgPointer), closureJmpLength)
+	orgPrologue := make([]byte, closureJmpLength)
+	copy(orgPrologue, funcPrologue)
+
+	newPrologue := make([]byte, closureJmpLength)
+	copy(newPrologue, closureJmpCode)
+	binary.NativeEndian.PutUint64(newPrologue[2:], uint64(uintptr(closure)))
+
 	replacePrologue(orgPointer, newPrologue) // OS-specific
 
 	return orgPrologue
 }
 
 func reset(ptr unsafe.Pointer, buf []byte) {
-	replacePrologue(ptr, buf) // OS-specific
+	if !samePrologue(ptr, buf) {
+		replacePrologue(ptr, buf) // OS-specific
+	}
 }
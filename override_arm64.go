@@ -25,6 +25,11 @@ import (
 const instrLength = 4
 const jmpInstrCode = uint8(0x14) // B instruction
 
+// LDR X26, #12; LDR X27, [X26]; BR X27; <closure> - X26 is the closure context register
+const closureJmpLength = 20
+
+var closureJmpCode = []uint32{0x5800007A, 0xF940035B, 0xD61F0360}
+
 func override(orgPointer, mockPointer unsafe.Pointer) []byte {
 	funcPrologue := unsafe.Slice((*uint8)(orgPointer), instrLength)
 	orgPrologue := make([]byte, instrLength)
@@ -35,15 +40,48 @@ func override(orgPointer, mockPointer unsafe.Pointer) []byte {
 	binary.NativeEndian.PutUint32(newPrologue, uint32(jumpLocation))
 	newPrologue[3] = jmpInstrCode
 
+	if !samePrologue(orgPointer, newPrologue) {
+		replacePrologue(orgPointer, newPrologue) // OS-specific
+
+		flushCache(orgPointer, instrLength)
+	}
+
+	return orgPrologue
+}
+
+// overrideClosure replaces function prologue with the jump to the closure, which can have
+// variables from enclosing scope, unlike mock installed with override()
+func overrideClosure(orgPointer, closure unsafe.Pointer) []byte {
+	checkFuncSize(orgPointer, closureJmpLength)
+
+	funcPrologue := unsafe.Slice((*uint8)(orgPointer), closureJmpLength)
+	orgPrologue := make([]byte, closureJmpLength)
+	copy(orgPrologue, funcPrologue)
+
+	newPrologue := make([]byte, closureJmpLength)
+	for i, instr := range closureJmpCode {
+		binary.NativeEndian.PutUint32(newPrologue[i*instrLength:], instr)
+	}
+	binary.NativeEndian.PutUint64(newPrologue[len(closureJmpCode)*instrLength:], uint64(uintptr(closure)))
+
 	replacePrologue(orgPointer, newPrologue) // OS-specific
 
-	C.flush_cache(C.uint64_t(uintptr(orgPointer)), C.size_t(instrLength))
+	flushCache(orgPointer, closureJmpLength)
 
 	return orgPrologue
 }
 
 func reset(ptr unsafe.Pointer, buf []byte) {
+	if samePrologue(ptr, buf) {
+		return
+	}
 	replacePrologue(ptr, buf) // OS-specific
 
-	C.flush_cache(C.uint64_t(uintptr(ptr)), C.size_t(instrLength))
+	flushCache(ptr, len(buf))
+}
+
+// flushCache invalidates instruction cache for <length> bytes of code at <ptr>
+func flushCache(ptr unsafe.Pointer, length int) {
+	stats.flushes.Add(1)
+	C.flush_cache(C.uint64_t(uintptr(ptr)), C.size_t(length))
 }
@@ -3,7 +3,9 @@ package testaroli
 import (
 	"context"
 	"errors"
+	"runtime"
 	"testing"
+	"time"
 )
 
 const key = contextKey(2)
@@ -338,3 +340,63 @@ func testError(t *testing.T, expected, actual error) {
 		return
 	}
 }
+
+func FuzzOverride(f *testing.F) {
+	f.Add(1, 2)
+	f.Add(-5, 1000)
+	f.Fuzz(func(t *testing.T, a, b int) {
+		a %= 100 // so foo() calls bar(a + 1)
+		ctx := TestingContext(t)
+		Override(ctx, bar, Once, func(i int) error {
+			Expectation().CheckArgs(i)
+			return nil
+		})(a + 1)
+		Override(ctx, bar, Once, func(i int) error {
+			Expectation().CheckArgs(i)
+			return errors.New("second")
+		})(b)
+
+		testError(t, nil, foo(a))
+		if bar(b) == nil {
+			t.Errorf("second override wasn't called")
+		}
+		testError(t, nil, ExpectationsWereMet())
+	})
+}
+
+// overrideIteration is the setup and teardown of the chain, like fuzz target does for each input
+func overrideIteration(t *testing.T) {
+	Override(TestingContext(t), bar, Once, func(i int) error {
+		Expectation()
+		return nil
+	})
+	testError(t, nil, foo(1))
+	testError(t, nil, ExpectationsWereMet())
+}
+
+func TestOverrideIterationCost(t *testing.T) {
+	overrideIteration(t) // code is made writable once per test
+	protects := Stats().ProtectCalls
+
+	const n = 1000
+	var before, after runtime.MemStats
+	runtime.ReadMemStats(&before)
+	start := time.Now()
+	for i := 0; i < n; i++ {
+		overrideIteration(t)
+	}
+	perIteration := time.Since(start) / n
+	runtime.ReadMemStats(&after)
+	bytes := (after.TotalAlloc - before.TotalAlloc) / n
+	t.Logf("%v, %d B per iteration", perIteration, bytes)
+
+	if d := Stats().ProtectCalls - protects; d != 0 {
+		t.Errorf("%d protection calls in %d iterations", d, n)
+	}
+	if bytes > 512 {
+		t.Errorf("iteration allocates %d bytes", bytes)
+	}
+	if perIteration > 50*time.Microsecond {
+		t.Errorf("iteration takes %v", perIteration)
+	}
+}
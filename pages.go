@@ -0,0 +1,119 @@
+//go:build linux || windows
+
+package testaroli
+
+import (
+	"os"
+	"sort"
+	"sync"
+	"testing"
+)
+
+/*
+Pages are made writable on the first write and stay writable while the test, which patches
+them, runs, so setting up and tearing down the chain of expectations doesn't change the
+protection. Original protection is restored when the test completes, or, for writes outside
+of the test, like ones of [Intercept], when the batch of writes completes.
+*/
+var pages struct {
+	sync.Mutex
+	orig     map[uintptr]uint32 // original protection of pages, ever made writable
+	writable map[uintptr]bool
+	batch    int // number of running batches
+}
+
+// tests, which restore the protection of pages when they complete
+var protectingTests sync.Map // *testing.T -> struct{}
+
+/*
+writeMem makes the area of <size> bytes at <start> writable with protection <prot>, unless it is
+already writable, and calls <write>. <orig> returns original protection of the page, it is
+called only when page is made writable for the first time.
+*/
+func writeMem(start, size uintptr, prot uint32, orig func(page uintptr) uint32, write func()) {
+	pageSize := uintptr(os.Getpagesize())
+	first := start &^ (pageSize - 1)
+	end := start + size
+
+	pages.Lock()
+	defer pages.Unlock()
+	if pages.orig == nil {
+		pages.orig = map[uintptr]uint32{}
+		pages.writable = map[uintptr]bool{}
+	}
+
+	for p := first; p < end; p += pageSize {
+		if !pages.writable[p] {
+			for p := first; p < end; p += pageSize {
+				if _, ok := pages.orig[p]; !ok {
+					pages.orig[p] = orig(p)
+				}
+				pages.writable[p] = true
+			}
+			stats.protects.Add(1)
+			if err := setProtection(first, end-first, prot); err != nil { // OS-specific
+				panic(err)
+			}
+			break
+		}
+	}
+	write()
+}
+
+// restoreAfter makes the original protection of the pages restored when test <t> completes
+func restoreAfter(t *testing.T) {
+	if _, loaded := protectingTests.LoadOrStore(t, struct{}{}); !loaded {
+		t.Cleanup(func() {
+			protectingTests.Delete(t)
+			pages.Lock()
+			defer pages.Unlock()
+			if pages.batch == 0 {
+				restoreProtection()
+			}
+		})
+	}
+}
+
+// restoreProtection restores the original protection of writable pages, changing protection
+// of adjacent pages with the same protection at once. Must be called with pages locked.
+func restoreProtection() {
+	pageSize := uintptr(os.Getpagesize())
+	writable := make([]uintptr, 0, len(pages.writable))
+	for p := range pages.writable {
+		writable = append(writable, p)
+	}
+	sort.Slice(writable, func(i, j int) bool { return writable[i] < writable[j] })
+
+	for i := 0; i < len(writable); {
+		j := i + 1
+		for j < len(writable) && writable[j] == writable[j-1]+pageSize && pages.orig[writable[j]] == pages.orig[writable[i]] {
+			j++
+		}
+		stats.protects.Add(1)
+		if err := setProtection(writable[i], writable[j-1]+pageSize-writable[i], pages.orig[writable[i]]); err != nil {
+			panic(err)
+		}
+		i = j
+	}
+	clear(pages.writable)
+}
+
+/*
+writeBatch calls <f>, which patches many functions, keeping the pages writable until it
+completes, so each page is made writable only once.
+*/
+func writeBatch(f func()) {
+	pages.Lock()
+	pages.batch++
+	pages.Unlock()
+
+	defer func() {
+		pages.Lock()
+		defer pages.Unlock()
+		pages.batch--
+		if pages.batch == 0 {
+			restoreProtection()
+		}
+	}()
+	f()
+}
@@ -0,0 +1,238 @@
+package testaroli
+
+import (
+	"bytes"
+	"fmt"
+	"reflect"
+	"runtime"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+/*
+patch is an override that isn't a part of the chain of expectations - it becomes effective
+immediately and stays in effect until it is removed, so several patches may be active at
+the same time. It is used for ready-made fakes, like [Clock], which need to override a group
+of functions at once.
+
+Patch never restores the original code while it is in effect, so it affects all goroutines.
+Original function is called through the trampoline, see [patch.callOriginal].
+*/
+type patch struct {
+	orgAddr     unsafe.Pointer
+	mockAddr    unsafe.Pointer
+	patchAddr   unsafe.Pointer // address of overwritten code, hooks are patched after the stack check
+	org         reflect.Value  // original function, set for hooks
+	hook        hookFunc       // called by runHook, set for hooks
+	closure     any            // keeps closure or data, referenced from the patched code, alive
+	orgPrologue []byte
+	code        uintptr // trampoline, which calls the original function
+	codeErr     error   // why the trampoline couldn't be made
+}
+
+/*
+patchedFuncs are the functions, patched by patches, by entry. Two patches of the same function,
+or the patch and the override in the chain, would overwrite the code, the other one relies on,
+and restore it in wrong order, so function can be patched only by one of them at a time.
+*/
+var patchedFuncs struct {
+	sync.Mutex
+	entries map[unsafe.Pointer]bool
+}
+
+// claimFunc registers function at <org> as patched, it panics if function is already patched,
+// or if it is overridden in the chain
+func claimFunc(org unsafe.Pointer) {
+	chainMu.RLock()
+	defer chainMu.RUnlock()
+	for i := 0; i < expectations.len(); i++ {
+		if expectations.at(i).orgAddr == org {
+			panic(fmt.Sprintf("function %s is already overridden", funcName(org)))
+		}
+	}
+
+	patchedFuncs.Lock()
+	defer patchedFuncs.Unlock()
+	if patchedFuncs.entries[org] {
+		panic(fmt.Sprintf("function %s is already patched", funcName(org)))
+	}
+	if patchedFuncs.entries == nil {
+		patchedFuncs.entries = map[unsafe.Pointer]bool{}
+	}
+	patchedFuncs.entries[org] = true
+}
+
+// checkNotPatched panics if function at <org> is patched, so it can't be overridden in the chain
+func checkNotPatched(org unsafe.Pointer) {
+	patchedFuncs.Lock()
+	defer patchedFuncs.Unlock()
+	if patchedFuncs.entries[org] {
+		panic(fmt.Sprintf("function %s is already patched", funcName(org)))
+	}
+}
+
+// hookFunc is called instead of the patched function, with the arguments of the call
+type hookFunc func(p *patch, args []reflect.Value) []reflect.Value
+
+func newPatch[T any](org, mock T) *patch {
+	p := patch{
+		orgAddr:  reflect.ValueOf(org).UnsafePointer(),
+		mockAddr: reflect.ValueOf(mock).UnsafePointer(),
+	}
+	p.patchAddr = p.orgAddr
+	claimFunc(p.orgAddr)
+	// trampoline is made from the original code, so before the code is patched
+	p.code, p.codeErr = callThrough(p.orgAddr, 0, entryJmpLength)
+	p.orgPrologue = override(p.orgAddr, p.mockAddr) // call arch-specific function
+	stats.overrides.Add(1)
+
+	return &p
+}
+
+/*
+newHook patches <org> with the closure, which calls <fn>. Unlike mocks for [Override] and
+newPatch, <fn> can use variables from enclosing scope, and it can call original function
+using [patch.call].
+*/
+func newHook(org any, fn hookFunc) *patch {
+	return newSwitchedHook(org, nil, fn)
+}
+
+/*
+newSwitchedHook works like newHook, but if <flag> isn't nil, the patched function calls <fn>
+only while uint32 at <flag> isn't zero, and otherwise it runs its original code, relocated to
+the stub, so switched off hook costs only the check of the flag.
+*/
+func newSwitchedHook(org any, flag unsafe.Pointer, fn hookFunc) *patch {
+	orgValue := reflect.ValueOf(org)
+	if orgValue.Kind() != reflect.Func {
+		panic("only function/method can be hooked")
+	}
+
+	p := &patch{orgAddr: orgValue.UnsafePointer(), org: orgValue, hook: fn}
+	p.closure = reflect.MakeFunc(orgValue.Type(), p.runHook).Interface()
+	p.applyStub(func(a *asm, from, size int) error {
+		p.code, p.codeErr = callThrough(p.orgAddr, from, size)
+		if flag != nil {
+			hook := a.jumpIfSet(flag)
+			if err := a.resume(p.orgAddr, from, size); err != nil {
+				return err
+			}
+			a.setJumpTarget(hook)
+		}
+		a.closureJump(closurePointer(p.closure))
+		return nil
+	})
+	stats.overrides.Add(1)
+
+	return p
+}
+
+// runHook is called instead of the hooked function with the arguments of the call, hookCaller
+// finds it in the stack, so it must not be inlined
+//
+//go:noinline
+func (p *patch) runHook(args []reflect.Value) []reflect.Value {
+	countCall(p.orgAddr)
+	defer countMockTime(time.Now())
+	return p.hook(p, args)
+}
+
+/*
+applyStub patches the function right after its stack check with the jump to the stub, which
+is generated by <gen>. <gen> gets the offset and the number of bytes, overwritten by the jump. As the stack
+check isn't overwritten, the patched function grows the stack itself, and when it's called
+again after the stack is grown, the stub isn't run twice.
+*/
+func (p *patch) applyStub(gen func(a *asm, from, size int) error) {
+	from := stackCheckLength(uintptr(p.orgAddr))
+	p.patchAddr = unsafe.Add(p.orgAddr, from)
+	claimFunc(p.orgAddr)
+	applied := false
+	defer func() {
+		if !applied { // function is too short, or its code can't be moved to the stub
+			releaseFunc(p.orgAddr)
+		}
+	}()
+	var jump []byte
+	_, err := placeCode(uintptr(p.orgAddr), func(a *asm) error {
+		var err error
+		if jump, err = hookJump(uintptr(p.patchAddr), a.base); err != nil {
+			return err
+		}
+		checkFuncSize(p.orgAddr, from+len(jump))
+		return gen(a, from, len(jump))
+	})
+	if err != nil {
+		panic(fmt.Sprintf("cannot patch function %s: %v", funcName(p.orgAddr), err))
+	}
+
+	p.orgPrologue = make([]byte, len(jump))
+	copy(p.orgPrologue, unsafe.Slice((*byte)(p.patchAddr), len(jump)))
+	reset(p.patchAddr, jump) // call arch-specific function
+	applied = true
+}
+
+// trampoline returns the trampoline, which calls the original function
+func (p *patch) trampoline() uintptr {
+	if p.codeErr != nil {
+		panic(fmt.Sprintf("cannot call original function: %v", p.codeErr))
+	}
+	return p.code
+}
+
+// call calls original function of the hook with <args>, as passed to the hook
+func (p *patch) call(args []reflect.Value) (res []reflect.Value) {
+	// time of original function isn't the time spent in the hook
+	start := time.Now()
+	defer func() { stats.mockNanos.Add(-int64(time.Since(start))) }()
+
+	p.callOriginal(func(fn unsafe.Pointer) {
+		org := reflect.NewAt(p.org.Type(), fn).Elem()
+		if org.Type().IsVariadic() {
+			res = org.CallSlice(args)
+		} else {
+			res = org.Call(args)
+		}
+	})
+
+	return res
+}
+
+func (p *patch) remove() {
+	reset(p.patchAddr, p.orgPrologue)
+	releaseFunc(p.orgAddr)
+}
+
+// releaseFunc makes function at <org>, which patch is removed, available for patching again
+func releaseFunc(org unsafe.Pointer) {
+	patchedFuncs.Lock()
+	defer patchedFuncs.Unlock()
+	delete(patchedFuncs.entries, org)
+}
+
+// closurePointer returns the pointer to the closure object of function value <fn>, while
+// reflect's Pointer() returns the pointer to the closure code
+func closurePointer(fn any) unsafe.Pointer {
+	return (*[2]unsafe.Pointer)(unsafe.Pointer(&fn))[1]
+}
+
+// checkFuncSize panics if function at <ptr> is too short to be overwritten with <size> bytes
+func checkFuncSize(ptr unsafe.Pointer, size int) {
+	if !funcFits(ptr, size) {
+		panic("function is too short to be overridden")
+	}
+}
+
+// funcFits reports whether function at <ptr> is long enough to be overwritten with <size> bytes
+func funcFits(ptr unsafe.Pointer, size int) bool {
+	// padding after the function end belongs to the function
+	f := runtime.FuncForPC(uintptr(ptr) + uintptr(size) - 1)
+	return f != nil && f.Entry() == uintptr(ptr)
+}
+
+// samePrologue reports whether function at <ptr> already starts with <buf>, so it doesn't need to be written
+func samePrologue(ptr unsafe.Pointer, buf []byte) bool {
+	return bytes.Equal(unsafe.Slice((*byte)(ptr), len(buf)), buf)
+}
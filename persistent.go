@@ -0,0 +1,114 @@
+package testaroli
+
+import (
+	"context"
+	"reflect"
+	"sync/atomic"
+	"unsafe"
+)
+
+/*
+Persistent is an override, which is installed once and then switched on and off by tests,
+see [OverridePersistent] for details.
+*/
+type Persistent[T any] struct {
+	p        *patch
+	mock     atomic.Pointer[reflect.Value] // nil if override is disabled
+	enabled  atomic.Uint32                 // checked by the patched code
+	restored atomic.Bool
+}
+
+/*
+OverridePersistent patches <org> once, so tests can switch the override with [Persistent.Enable]
+and [Persistent.Disable] without patching the code again. It is intended for packages, where many
+tests override the same functions, and should be called from TestMain:
+
+	var fetch *Persistent[func(string) ([]byte, error)]
+
+	func TestMain(m *testing.M) {
+	    fetch = OverridePersistent(download)
+	    code := m.Run()
+	    fetch.Restore()
+	    os.Exit(code)
+	}
+
+	func TestNotFound(t *testing.T) {
+	    fetch.Enable(TestingContext(t), func(url string) ([]byte, error) {
+	        return nil, ErrNotFound
+	    })
+
+	    ...
+	}
+
+While override is disabled, calls go through to the original function, so override doesn't
+change the behaviour of the tests, which don't enable it. Enable and Disable only swap the
+pointer, and unlike mocks for [Override], mock can use variables from enclosing scope. Calls
+aren't checked against the chain of expectations, so mock doesn't need to call [Expectation].
+
+While override is disabled, patched function only checks the flag and runs its original code,
+which is moved to the stub, so calls from different goroutines run in parallel and cost almost
+as much as calls of the original function. The code is patched until [Persistent.Restore] is called, which is not needed if override stays in place
+until the test binary exits. Like with [Override], it is necessary to disable function inlining
+to make OverridePersistent work.
+*/
+func OverridePersistent[T any](org T) *Persistent[T] {
+	s := &Persistent[T]{}
+	s.p = newSwitchedHook(org, unsafe.Pointer(&s.enabled), func(p *patch, args []reflect.Value) []reflect.Value {
+		mock := s.mock.Load()
+		if mock == nil { // disabled after the flag was checked
+			return p.call(args)
+		}
+		if mock.Type().IsVariadic() {
+			return mock.CallSlice(args)
+		}
+		return mock.Call(args)
+	})
+
+	return s
+}
+
+/*
+Enable makes <mock> to be called instead of the original function until the test, which
+context is passed to Enable, completes, or until [Persistent.Disable] is called. Enabling
+already enabled override replaces the mock, and when the test completes, the replaced mock,
+e.g. the one of the parent test, is called again.
+*/
+func (s *Persistent[T]) Enable(ctx context.Context, mock T) {
+	if s.restored.Load() {
+		panic("persistent override is already restored")
+	}
+	t := Testing(ctx)
+
+	m := reflect.ValueOf(mock)
+	if m.IsNil() {
+		panic("mock cannot be nil")
+	}
+	prev := s.mock.Swap(&m)
+	s.enabled.Store(1)
+	// mock of the parent test, or the one, replaced within the same test, is effective again
+	t.Cleanup(func() {
+		if prev == nil {
+			s.Disable()
+			return
+		}
+		s.mock.Store(prev)
+	})
+}
+
+/*
+Disable makes calls go through to the original function.
+*/
+func (s *Persistent[T]) Disable() {
+	s.enabled.Store(0)
+	s.mock.Store(nil)
+}
+
+/*
+Restore restores the original function, after that override cannot be enabled.
+*/
+func (s *Persistent[T]) Restore() {
+	if !s.restored.Swap(true) {
+		s.Disable()
+		s.p.remove()
+	}
+}
@@ -0,0 +1,79 @@
+package testaroli
+
+import (
+	"errors"
+	"reflect"
+	"testing"
+)
+
+func TestPersistent(t *testing.T) {
+	bars := OverridePersistent(bar)
+	defer bars.Restore()
+
+	testError(t, nil, foo(1)) // disabled - original bar(2) is called
+
+	t.Run("enabled", func(t *testing.T) {
+		err := errors.New("persistent")
+		bars.Enable(TestingContext(t), func(i int) error {
+			if i != 2 {
+				t.Errorf("unexpected arg %d", i)
+			}
+			return err
+		})
+		testError(t, err, foo(1))
+
+		// reconfigure
+		bars.Enable(TestingContext(t), func(i int) error { return nil })
+		testError(t, nil, foo(2))
+	})
+
+	if err := foo(2); err == nil || err.Error() != "even" { // disabled, when subtest completed
+		t.Errorf("unexpected error %v", err)
+	}
+
+	bars.Restore()
+	if err := foo(2); err == nil || err.Error() != "even" {
+		t.Errorf("unexpected error %v", err)
+	}
+	defer func() {
+		if r := recover(); r == nil {
+			t.Errorf("restored override enabled")
+		}
+	}()
+	bars.Enable(TestingContext(t), func(i int) error { return nil })
+}
+
+func TestPersistentDisabledBypassesHook(t *testing.T) {
+	bars := OverridePersistent(bar)
+	defer bars.Restore()
+	calls := callCounter(reflect.ValueOf(bar).UnsafePointer())
+
+	before := calls.Load()
+	testError(t, nil, foo(1))
+	if n := calls.Load() - before; n != 0 {
+		t.Errorf("disabled override made %d hook calls", n)
+	}
+
+	t.Run("enabled", func(t *testing.T) {
+		bars.Enable(TestingContext(t), func(i int) error { return nil })
+		testError(t, nil, foo(2))
+		if n := calls.Load() - before; n != 1 {
+			t.Errorf("enabled override made %d hook calls", n)
+		}
+	})
+}
+
+func TestPersistentNested(t *testing.T) {
+	bars := OverridePersistent(bar)
+	defer bars.Restore()
+
+	parent := errors.New("parent")
+	bars.Enable(TestingContext(t), func(i int) error { return parent })
+
+	t.Run("child", func(t *testing.T) {
+		bars.Enable(TestingContext(t), func(i int) error { return nil })
+		testError(t, nil, foo(1))
+	})
+
+	testError(t, parent, foo(1)) // mock of the parent is restored
+}
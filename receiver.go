@@ -0,0 +1,121 @@
+package testaroli
+
+import (
+	"context"
+	"fmt"
+	"reflect"
+	"sync"
+	"unsafe"
+)
+
+// receiverHook dispatches calls of the method to the mocks of the receivers
+type receiverHook struct {
+	p     *patch
+	mu    sync.RWMutex
+	mocks map[unsafe.Pointer]reflect.Value // receiver -> mock
+}
+
+var (
+	receiverHooks   = map[unsafe.Pointer]*receiverHook{} // method -> hook
+	receiverHooksMu sync.Mutex                           // protects receiverHooks
+)
+
+/*
+OverrideReceiver overrides <method> with <mock> only for calls on <receiver>, calls on other
+receivers go to the original method. <method> must be a method expression with pointer
+receiver, and <receiver> must be a pointer of the receiver's type. Method receiver becomes
+the first argument of the mock, like with [Override]:
+
+	func TestTransfer(t *testing.T) {
+	    from, to := &Account{}, &Account{}
+	    OverrideReceiver(TestingContext(t), (*Account).Withdraw, from, func(a *Account, sum int) error {
+	        return ErrInsufficientFunds
+	    })
+
+	    if err := Transfer(from, to, 100); !errors.Is(err, ErrInsufficientFunds) {
+	        t.Errorf("unexpected %v", err)
+	    }
+	}
+
+Method is patched once for all receivers, and the mock is found by the receiver address in
+the hash map, so independent tests and subtests can override the same method for their own
+receivers, and the mocks don't need to check which receiver they are called for. Unlike
+mocks for [Override], mock can use variables from enclosing scope, and it doesn't need to
+call [Expectation], as calls aren't checked against the chain of expectations.
+
+Overriding the method again for the same receiver replaces the mock until the test, which
+overrides it again, completes, and then the replaced mock, e.g. the one of the parent test,
+is called again. Override is removed when test, which context is passed to OverrideReceiver,
+completes, and method is restored when there are no receivers left. Calls on other receivers go to the original method through
+the trampoline, so the patch stays in place and calls from different goroutines run in
+parallel. Like with [Override], it is necessary to disable function inlining to make
+OverrideReceiver work.
+*/
+func OverrideReceiver[T any](ctx context.Context, method T, receiver any, mock T) {
+	t := Testing(ctx)
+
+	typ := reflect.TypeOf(method)
+	if typ.Kind() != reflect.Func || typ.NumIn() == 0 || typ.In(0).Kind() != reflect.Pointer {
+		panic("OverrideReceiver() can be called only for method with pointer receiver")
+	}
+	recv := reflect.ValueOf(receiver)
+	if recv.Type() != typ.In(0) || recv.IsNil() {
+		panic(fmt.Sprintf("receiver must be non-nil %s", typ.In(0)))
+	}
+	mockValue := reflect.ValueOf(mock)
+	if mockValue.IsNil() {
+		panic("mock cannot be nil")
+	}
+
+	orgPointer := reflect.ValueOf(method).UnsafePointer()
+	recvPointer := recv.UnsafePointer()
+
+	receiverHooksMu.Lock()
+	defer receiverHooksMu.Unlock()
+
+	h := receiverHooks[orgPointer]
+	if h == nil {
+		h = &receiverHook{mocks: map[unsafe.Pointer]reflect.Value{}}
+		h.p = newHook(method, h.dispatch)
+		receiverHooks[orgPointer] = h
+	}
+	h.mu.Lock()
+	prev, overridden := h.mocks[recvPointer]
+	h.mocks[recvPointer] = mockValue
+	h.mu.Unlock()
+
+	t.Cleanup(func() {
+		receiverHooksMu.Lock()
+		defer receiverHooksMu.Unlock()
+
+		h.mu.Lock()
+		// mock of the parent test, or the one, replaced within the same test, is effective again
+		if overridden {
+			h.mocks[recvPointer] = prev
+		} else {
+			delete(h.mocks, recvPointer)
+		}
+		empty := len(h.mocks) == 0
+		h.mu.Unlock()
+		if empty {
+			h.p.remove()
+			delete(receiverHooks, orgPointer)
+		}
+	})
+}
+
+// dispatch calls the mock for the receiver, which is the first of <args>, or original method
+func (h *receiverHook) dispatch(p *patch, args []reflect.Value) []reflect.Value {
+	h.mu.RLock()
+	mock, ok := h.mocks[args[0].UnsafePointer()]
+	h.mu.RUnlock()
+
+	if !ok {
+		return p.call(args)
+	}
+	if mock.Type().IsVariadic() {
+		return mock.CallSlice(args)
+	}
+
+	return mock.Call(args)
+}
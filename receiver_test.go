@@ -0,0 +1,82 @@
+package testaroli
+
+import (
+	"testing"
+)
+
+type account struct{ balance int }
+
+func (a *account) Balance() int { return a.balance }
+
+func (a *account) Deposit(sums ...int) int {
+	for _, s := range sums {
+		a.balance += s
+	}
+	return a.balance
+}
+
+func TestOverrideReceiver(t *testing.T) {
+	a, b := &account{balance: 1}, &account{balance: 2}
+
+	t.Run("a", func(t *testing.T) {
+		OverrideReceiver(TestingContext(t), (*account).Balance, a, func(*account) int { return 10 })
+		OverrideReceiver(TestingContext(t), (*account).Deposit, a, func(_ *account, sums ...int) int { return len(sums) })
+		if a.Balance() != 10 || b.Balance() != 2 {
+			t.Errorf("unexpected balances %d, %d", a.Balance(), b.Balance())
+		}
+		if a.Deposit(5, 5) != 2 || b.Deposit(5, 5) != 12 {
+			t.Errorf("unexpected deposit")
+		}
+
+		t.Run("b", func(t *testing.T) {
+			OverrideReceiver(TestingContext(t), (*account).Balance, b, func(*account) int { return 20 })
+			if a.Balance() != 10 || b.Balance() != 20 {
+				t.Errorf("unexpected balances %d, %d", a.Balance(), b.Balance())
+			}
+		})
+
+		if a.Balance() != 10 || b.Balance() != 12 {
+			t.Errorf("unexpected balances %d, %d", a.Balance(), b.Balance())
+		}
+	})
+
+	if a.Balance() != 1 || b.Balance() != 12 {
+		t.Errorf("unexpected balances %d, %d", a.Balance(), b.Balance())
+	}
+	if len(receiverHooks) != 0 {
+		t.Errorf("methods aren't restored")
+	}
+}
+
+func TestOverrideReceiverNested(t *testing.T) {
+	a := &account{balance: 1}
+	OverrideReceiver(TestingContext(t), (*account).Balance, a, func(*account) int { return 10 })
+
+	t.Run("child", func(t *testing.T) {
+		OverrideReceiver(TestingContext(t), (*account).Balance, a, func(*account) int { return 20 })
+		if a.Balance() != 20 {
+			t.Errorf("unexpected balance %d", a.Balance())
+		}
+	})
+
+	if a.Balance() != 10 { // mock of the parent is restored
+		t.Errorf("unexpected balance %d", a.Balance())
+	}
+}
+
+func TestOverrideReceiverInvalid(t *testing.T) {
+	for _, fn := range []func(){
+		func() { OverrideReceiver(TestingContext(t), foo, &account{}, foo) },
+		func() { OverrideReceiver(TestingContext(t), (*account).Balance, account{}, (*account).Balance) },
+		func() { OverrideReceiver(TestingContext(t), (*account).Balance, (*account)(nil), (*account).Balance) },
+	} {
+		func() {
+			defer func() {
+				if r := recover(); r == nil {
+					t.Errorf("invalid override didn't panic")
+				}
+			}()
+			fn()
+		}()
+	}
+}
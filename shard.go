@@ -0,0 +1,316 @@
+package testaroli
+
+import (
+	"bufio"
+	"bytes"
+	"flag"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"regexp"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+	"testing"
+)
+
+// environment variable, which marks the worker process of RunSharded and holds its shard number
+const shardEnv = "TESTAROLI_SHARD"
+
+/*
+RunSharded runs the tests of the package in <workers> processes, or in [runtime.NumCPU]
+processes if <workers> isn't positive, and returns the exit code. It is intended to be
+called from TestMain:
+
+	func TestMain(m *testing.M) {
+	    os.Exit(RunSharded(m, 0))
+	}
+
+Overrides patch the code of the whole process, so tests, which use them, can't run in
+parallel within one process. RunSharded re-executes the test binary as worker processes,
+each running its own share of the top-level tests with -test.run, so every worker has its
+own patches and tests in different workers run in parallel. Output of the workers is printed
+as each worker completes, without interleaving. Each worker writes coverage counters into its
+own directory, so they are counted once, and then they are moved into the directory, requested
+with -test.gocoverdir, and coverage profiles of the workers are merged into the one, requested
+with -coverprofile.
+
+Tests are run in one process, as usual, when listing, benchmarking or fuzzing, or if
+there is only one test or worker. Tests, distributed between workers, must not depend on
+each other.
+*/
+func RunSharded(m *testing.M, workers int) int {
+	if os.Getenv(shardEnv) != "" {
+		return m.Run() // worker
+	}
+
+	if !flag.Parsed() {
+		flag.Parse()
+	}
+	if workers <= 0 {
+		workers = runtime.NumCPU()
+	}
+	for _, name := range []string{"test.list", "test.bench", "test.fuzz", "test.fuzzworker"} {
+		if f := flag.Lookup(name); f != nil && f.Value.String() != "" && f.Value.String() != "false" {
+			return m.Run()
+		}
+	}
+
+	tests, err := listTests(flagValue("test.run"))
+	if err != nil || len(tests) < 2 || workers < 2 {
+		return m.Run()
+	}
+	workers = min(workers, len(tests))
+
+	dir, err := os.MkdirTemp("", "testaroli")
+	if err != nil {
+		return m.Run()
+	}
+	defer os.RemoveAll(dir)
+
+	coverProfile := flagValue("test.coverprofile")
+	coverDir := flagValue("test.gocoverdir")
+	args := filterArgs(os.Args[1:], "test.run", "test.coverprofile", "test.gocoverdir")
+
+	results := make(chan shardResult, workers)
+	for i := 0; i < workers; i++ {
+		var shard []string
+		for j := i; j < len(tests); j += workers {
+			shard = append(shard, regexp.QuoteMeta(tests[j]))
+		}
+		shardArgs := append([]string{"-test.run=^(" + strings.Join(shard, "|") + ")$"}, args...)
+		profile := ""
+		if coverProfile != "" {
+			profile = filepath.Join(dir, fmt.Sprintf("cover%d.out", i))
+			shardArgs = append(shardArgs, "-test.coverprofile="+profile)
+		}
+		if coverDir != "" {
+			// worker builds its profile from all counters in the directory, so if directory is
+			// shared, counters of other workers are counted again
+			workerDir := filepath.Join(dir, fmt.Sprintf("covdata%d", i))
+			if err := os.Mkdir(workerDir, 0o755); err != nil {
+				return m.Run()
+			}
+			shardArgs = append(shardArgs, "-test.gocoverdir="+workerDir)
+		}
+		go func(i int) {
+			results <- runShard(i, shardArgs, profile)
+		}(i)
+	}
+
+	code := 0
+	var profiles []string
+	for i := 0; i < workers; i++ {
+		res := <-results
+		os.Stdout.Write(res.output)
+		if res.code != 0 {
+			code = res.code
+		}
+		if res.profile != "" {
+			profiles = append(profiles, res.profile)
+		}
+	}
+
+	if coverDir != "" {
+		for i := 0; i < workers; i++ {
+			if err := moveFiles(filepath.Join(dir, fmt.Sprintf("covdata%d", i)), coverDir); err != nil {
+				fmt.Fprintf(os.Stderr, "testaroli: cannot move coverage data: %v\n", err)
+				code = 1
+			}
+		}
+	}
+	if coverProfile != "" {
+		if !filepath.IsAbs(coverProfile) && flagValue("test.outputdir") != "" {
+			coverProfile = filepath.Join(flagValue("test.outputdir"), coverProfile)
+		}
+		sort.Strings(profiles)
+		if err := mergeCoverProfiles(coverProfile, profiles); err != nil {
+			fmt.Fprintf(os.Stderr, "testaroli: cannot merge coverage profiles: %v\n", err)
+			code = 1
+		}
+	}
+
+	return code
+}
+
+type shardResult struct {
+	output  []byte
+	code    int
+	profile string
+}
+
+// runShard runs the test binary as worker <i>
+func runShard(i int, args []string, profile string) shardResult {
+	cmd := exec.Command(os.Args[0], args...)
+	cmd.Env = append(os.Environ(), shardEnv+"="+strconv.Itoa(i))
+	output, err := cmd.CombinedOutput()
+
+	res := shardResult{output: output, profile: profile}
+	if err != nil {
+		res.code = 1
+		if exitErr, ok := err.(*exec.ExitError); ok && exitErr.ExitCode() > 0 {
+			res.code = exitErr.ExitCode()
+		} else {
+			res.output = append(res.output, fmt.Sprintf("testaroli: worker %d failed: %v\n", i, err)...)
+		}
+	}
+	if _, err := os.Stat(profile); err != nil {
+		res.profile = ""
+	}
+
+	return res
+}
+
+// listTests returns names of top-level tests, examples and fuzz targets, matching <pattern>
+func listTests(pattern string) ([]string, error) {
+	if pattern == "" {
+		pattern = "."
+	}
+	if i := strings.Index(pattern, "/"); i >= 0 {
+		pattern = pattern[:i] // subtests are run by their parents
+	}
+
+	cmd := exec.Command(os.Args[0], "-test.list="+pattern)
+	cmd.Env = append(os.Environ(), shardEnv+"=list")
+	output, err := cmd.Output()
+	if err != nil {
+		return nil, err
+	}
+
+	var tests []string
+	for _, name := range strings.Fields(string(output)) {
+		// benchmarks aren't run by -test.run, unlike fuzz targets, which run their seed corpus
+		if !strings.HasPrefix(name, "Benchmark") {
+			tests = append(tests, name)
+		}
+	}
+
+	return tests, nil
+}
+
+// moveFiles moves files from directory <from> to directory <to>, which already exists
+func moveFiles(from, to string) error {
+	entries, err := os.ReadDir(from)
+	if err != nil {
+		return err
+	}
+	for _, e := range entries {
+		if err := os.Rename(filepath.Join(from, e.Name()), filepath.Join(to, e.Name())); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// flagValue returns the value of command line flag, or empty string if flag isn't defined
+func flagValue(name string) string {
+	if f := flag.Lookup(name); f != nil {
+		return f.Value.String()
+	}
+
+	return ""
+}
+
+// filterArgs removes flags <names> with their values from <args>
+func filterArgs(args []string, names ...string) []string {
+	var filtered []string
+	for i := 0; i < len(args); i++ {
+		name, _, hasValue := strings.Cut(strings.TrimLeft(args[i], "-"), "=")
+		if !strings.HasPrefix(args[i], "-") || !contains(names, name) {
+			filtered = append(filtered, args[i])
+			continue
+		}
+		if !hasValue {
+			i++ // value is the next arg
+		}
+	}
+
+	return filtered
+}
+
+func contains(list []string, s string) bool {
+	for _, l := range list {
+		if l == s {
+			return true
+		}
+	}
+
+	return false
+}
+
+/*
+mergeCoverProfiles merges coverage profiles, written by workers, into <output>. Counts
+of the same blocks are summed, or, for "set" mode, set if set in any profile.
+*/
+func mergeCoverProfiles(output string, profiles []string) error {
+	mode := ""
+	counts := map[string]int64{}
+	var blocks []string
+	for _, profile := range profiles {
+		f, err := os.Open(profile)
+		if err != nil {
+			return err
+		}
+		err = readCoverProfile(f, func(m string) error {
+			if mode != "" && m != mode {
+				return fmt.Errorf("profile %s has mode %s, expected %s", profile, m, mode)
+			}
+			mode = m
+			return nil
+		}, func(block string, count int64) {
+			if _, ok := counts[block]; !ok {
+				blocks = append(blocks, block)
+			}
+			if mode == "set" {
+				counts[block] = max(counts[block], count)
+			} else {
+				counts[block] += count
+			}
+		})
+		f.Close()
+		if err != nil {
+			return err
+		}
+	}
+	if mode == "" {
+		return nil // no profiles
+	}
+
+	var buf bytes.Buffer
+	fmt.Fprintf(&buf, "mode: %s\n", mode)
+	for _, block := range blocks {
+		fmt.Fprintf(&buf, "%s %d\n", block, counts[block])
+	}
+
+	return os.WriteFile(output, buf.Bytes(), 0o644)
+}
+
+// readCoverProfile parses coverage profile, calling <setMode> for its mode and <addBlock> for each block
+func readCoverProfile(r io.Reader, setMode func(string) error, addBlock func(string, int64)) error {
+	scanner := bufio.NewScanner(r)
+	for scanner.Scan() {
+		line := scanner.Text()
+		if mode, ok := strings.CutPrefix(line, "mode: "); ok {
+			if err := setMode(mode); err != nil {
+				return err
+			}
+			continue
+		}
+		// file:line.col,line.col numStmt count
+		i := strings.LastIndexByte(line, ' ')
+		if i < 0 {
+			continue
+		}
+		count, err := strconv.ParseInt(line[i+1:], 10, 64)
+		if err != nil {
+			return fmt.Errorf("invalid profile line %q", line)
+		}
+		addBlock(line[:i], count)
+	}
+
+	return scanner.Err()
+}
@@ -0,0 +1,103 @@
+package testaroli
+
+import (
+	"os"
+	"os/exec"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"testing"
+)
+
+// TestRunSharded runs the tests of the package sharded when this variable is set
+const shardedTestEnv = "TESTAROLI_TEST_SHARDED"
+
+func TestMain(m *testing.M) {
+	if os.Getenv(shardedTestEnv) != "" {
+		os.Exit(RunSharded(m, 3))
+	}
+	os.Exit(m.Run())
+}
+
+func TestRunSharded(t *testing.T) {
+	if os.Getenv(shardEnv) != "" {
+		t.Skip("already in worker")
+	}
+
+	dir := t.TempDir()
+	profile := filepath.Join(dir, "cover.out")
+	args := []string{"-test.v", "-test.run", "^(Test(SingleCall|SeveralCalls|Spy|Chain|Group)|FuzzFilterArgs)$"}
+	if testing.CoverMode() != "" {
+		args = append(args, "-test.coverprofile="+profile)
+	}
+	cmd := exec.Command(os.Args[0], args...)
+	cmd.Env = append(os.Environ(), shardedTestEnv+"=1")
+	output, err := cmd.CombinedOutput()
+	if err != nil {
+		t.Fatalf("sharded run failed: %v\n%s", err, output)
+	}
+
+	for _, test := range []string{"TestSingleCall", "TestSeveralCalls", "TestSpy", "TestChain", "TestGroup", "FuzzFilterArgs"} {
+		if strings.Count(string(output), "--- PASS: "+test+" ") != 1 {
+			t.Errorf("test %s wasn't run exactly once:\n%s", test, output)
+		}
+	}
+	if strings.Contains(string(output), "TestSpyOverride") {
+		t.Errorf("test, not matching the pattern, was run:\n%s", output)
+	}
+
+	if testing.CoverMode() != "" {
+		data, err := os.ReadFile(profile)
+		if err != nil || !strings.HasPrefix(string(data), "mode: ") {
+			t.Errorf("coverage profile isn't merged: %v", err)
+		}
+	}
+}
+
+func TestFilterArgs(t *testing.T) {
+	args := []string{"-test.v", "-test.run", "Foo", "-test.coverprofile=c.out", "--test.run=Bar", "-test.count=1", "pos"}
+	filtered := filterArgs(args, "test.run", "test.coverprofile")
+	if !reflect.DeepEqual(filtered, []string{"-test.v", "-test.count=1", "pos"}) {
+		t.Errorf("unexpected args %v", filtered)
+	}
+}
+
+func FuzzFilterArgs(f *testing.F) {
+	f.Add("-test.run=Foo -test.v")
+	f.Add("-test.run Foo")
+	f.Fuzz(func(t *testing.T, s string) {
+		for _, arg := range filterArgs(strings.Fields(s), "test.run") {
+			if name, _, _ := strings.Cut(strings.TrimLeft(arg, "-"), "="); strings.HasPrefix(arg, "-") && name == "test.run" {
+				t.Errorf("flag %s isn't removed from %q", arg, s)
+			}
+		}
+	})
+}
+
+func TestMergeCoverProfiles(t *testing.T) {
+	dir := t.TempDir()
+	write := func(name, content string) string {
+		path := filepath.Join(dir, name)
+		if err := os.WriteFile(path, []byte(content), 0o644); err != nil {
+			t.Fatal(err)
+		}
+		return path
+	}
+	p1 := write("1.out", "mode: count\nfoo.go:1.1,2.2 1 3\nfoo.go:3.1,4.2 2 0\n")
+	p2 := write("2.out", "mode: count\nfoo.go:1.1,2.2 1 1\nfoo.go:3.1,4.2 2 5\nbar.go:1.1,2.2 1 1\n")
+	out := filepath.Join(dir, "merged.out")
+
+	if err := mergeCoverProfiles(out, []string{p1, p2}); err != nil {
+		t.Fatal(err)
+	}
+	data, _ := os.ReadFile(out)
+	expected := "mode: count\nfoo.go:1.1,2.2 1 4\nfoo.go:3.1,4.2 2 5\nbar.go:1.1,2.2 1 1\n"
+	if string(data) != expected {
+		t.Errorf("unexpected merged profile:\n%s", data)
+	}
+
+	p3 := write("3.out", "mode: set\nfoo.go:1.1,2.2 1 1\n")
+	if err := mergeCoverProfiles(out, []string{p1, p3}); err == nil {
+		t.Errorf("profiles with different modes merged")
+	}
+}
@@ -0,0 +1,88 @@
+package testaroli
+
+import (
+	"context"
+	"reflect"
+	"sync/atomic"
+	"unsafe"
+)
+
+/*
+Counter counts the calls of the function, see [Spy] for details.
+*/
+type Counter struct {
+	calls atomic.Int64
+}
+
+/*
+Spy patches function <fn> to count its calls, and then call the original function. Unlike
+[Override], it doesn't require the mock or [Expectation] call, so it is the cheapest way
+to check how many times the function was called:
+
+	func TestCacheHit(t *testing.T) {
+	    decodes := Spy(TestingContext(t), decode)
+
+	    cache.Get("foo") // miss - value is decoded
+	    cache.Get("foo") // hit - value is taken from cache
+	    if decodes.Calls() != 1 {
+	        t.Errorf("decode called %d times", decodes.Calls())
+	    }
+	}
+
+Function is patched with the jump to the native stub, which atomically increments the counter
+and continues with the original function, so Spy adds only a few instructions to the call,
+calls from different goroutines run in parallel, and recursive calls are counted too.
+
+Function can't be spied on while it is overridden in the chain of expectations, or patched by
+another Spy, [Intercept] or the fake, like [FakeClock], and it can't be overridden while it is
+spied on - Spy panics in the first case, and [Override] - in the second one.
+
+Original function is restored when test, which context is passed to Spy, completes.
+Like with [Override], it is necessary to disable function inlining to make Spy work.
+*/
+func Spy(ctx context.Context, fn any) *Counter {
+	t := Testing(ctx)
+
+	fnValue := reflect.ValueOf(fn)
+	if fnValue.Kind() != reflect.Func {
+		panic("only function/method can be spied on")
+	}
+
+	c := &Counter{}
+	p := newCountingStub(fnValue.UnsafePointer(), &c.calls, c)
+
+	t.Cleanup(p.remove)
+
+	return c
+}
+
+/*
+newCountingStub patches function at <org> with the jump to the native stub, which atomically
+increments <counter> and continues with the original function. <counter> is referenced from
+the stub, so it must belong to <owner>, which patch keeps alive.
+*/
+func newCountingStub(org unsafe.Pointer, counter *atomic.Int64, owner any) *patch {
+	p := &patch{orgAddr: org, closure: owner}
+	p.applyStub(func(a *asm, from, size int) error {
+		a.increment(unsafe.Pointer(counter))
+		a.increment(unsafe.Pointer(callCounter(p.orgAddr)))
+		return a.resume(p.orgAddr, from, size)
+	})
+	stats.overrides.Add(1)
+
+	return p
+}
+
+/*
+Calls returns the number of calls since the function was spied on or since the last [Counter.Reset].
+*/
+func (c *Counter) Calls() int {
+	return int(c.calls.Load())
+}
+
+/*
+Reset resets the number of calls to zero.
+*/
+func (c *Counter) Reset() {
+	c.calls.Store(0)
+}
@@ -0,0 +1,126 @@
+package testaroli
+
+import (
+	"sync"
+	"testing"
+)
+
+func TestSpy(t *testing.T) {
+	ctx := TestingContext(t)
+	bars := Spy(ctx, bar)
+	bazs := Spy(ctx, baz)
+
+	testError(t, nil, foo(106))
+	if bars.Calls() != 1 || bazs.Calls() != 6 {
+		t.Errorf("unexpected number of calls %d, %d", bars.Calls(), bazs.Calls())
+	}
+
+	bazs.Reset()
+	testError(t, nil, foo(1))
+	if bars.Calls() != 2 || bazs.Calls() != 0 {
+		t.Errorf("unexpected number of calls %d, %d", bars.Calls(), bazs.Calls())
+	}
+}
+
+func TestSpyOverride(t *testing.T) {
+	ctx := TestingContext(t)
+	quxs := Spy(ctx, qux)
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation().CheckArgs(i)
+		return qux(nil)
+	})(2)
+
+	testError(t, nil, foo(1))
+	testError(t, nil, ExpectationsWereMet())
+	if quxs.Calls() != 1 {
+		t.Errorf("unexpected number of calls %d", quxs.Calls())
+	}
+}
+
+func TestSpyConcurrent(t *testing.T) {
+	facts := Spy(TestingContext(t), fact)
+
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for j := 0; j < 2000; j++ {
+				fact(1)
+			}
+		}()
+	}
+	wg.Wait()
+
+	if facts.Calls() != 8*2000 {
+		t.Errorf("unexpected number of calls %d", facts.Calls())
+	}
+}
+
+func TestSpyOverridden(t *testing.T) {
+	ctx := TestingContext(t)
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation()
+		return nil
+	})
+	func() {
+		defer func() {
+			if r := recover(); r == nil {
+				t.Errorf("overridden function is spied on")
+			}
+		}()
+		Spy(ctx, bar)
+	}()
+
+	// override isn't broken by refused spy
+	testError(t, nil, bar(1))
+	testError(t, nil, ExpectationsWereMet())
+	// original function is restored
+	if err := bar(1); err == nil || err.Error() != "even" {
+		t.Errorf("unexpected error %v", err)
+	}
+}
+
+func TestOverrideSpied(t *testing.T) {
+	t.Run("spied", func(t *testing.T) {
+		ctx := TestingContext(t)
+		bars := Spy(ctx, bar)
+		cases := map[string]func(){
+			"override": func() {
+				Override(ctx, bar, Once, func(i int) error {
+					Expectation()
+					return nil
+				})
+			},
+			"spy":       func() { Spy(ctx, bar) },
+			"intercept": func() { Intercept(ctx, "", nil, bar) },
+		}
+		for name, patch := range cases {
+			func() {
+				defer func() {
+					if r := recover(); r == nil {
+						t.Errorf("case '%s' didn't panic", name)
+					}
+				}()
+				patch()
+			}()
+		}
+		testError(t, nil, ExpectationsWereMet())
+
+		if err := bar(1); err == nil || err.Error() != "even" {
+			t.Errorf("unexpected error %v", err)
+		}
+		if bars.Calls() != 1 {
+			t.Errorf("unexpected number of calls %d", bars.Calls())
+		}
+	})
+
+	// function can be overridden, when spy is removed
+	ctx := TestingContext(t)
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation()
+		return nil
+	})
+	testError(t, nil, bar(1))
+	testError(t, nil, ExpectationsWereMet())
+}
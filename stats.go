@@ -0,0 +1,124 @@
+package testaroli
+
+import (
+	"fmt"
+	"io"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"time"
+	"unsafe"
+)
+
+var stats struct {
+	overrides  atomic.Int64
+	writes     atomic.Int64
+	protects   atomic.Int64
+	flushes    atomic.Int64
+	patchNanos atomic.Int64
+	mockNanos  atomic.Int64
+	calls      sync.Map // entry of overridden function -> *atomic.Int64
+}
+
+/*
+PatchStats holds statistics of patching activity since the start of the test binary, see [Stats].
+*/
+type PatchStats struct {
+	Overrides      int64            // number of overrides, made with Override, Spy, fakes etc.
+	PrologueWrites int64            // number of writes of function prologues
+	ProtectCalls   int64            // number of system calls to make the code writable
+	CacheFlushes   int64            // number of instruction cache flushes (ARM64 only)
+	PatchTime      time.Duration    // time spent writing prologues, including protection calls
+	MockTime       time.Duration    // time spent in hooks, excluding original functions
+	Calls          map[string]int64 // number of calls of overridden functions, by function name
+}
+
+/*
+Stats returns statistics of patching activity since the start of the test binary. It allows
+to find out whether the tests spend their time in patching or in the code under test:
+
+	func TestMain(m *testing.M) {
+	    code := m.Run()
+	    WriteStats(os.Stderr)
+	    os.Exit(code)
+	}
+
+Calls are counted for the mocks, which call [Expectation], and for the hooks, installed with
+[Spy], [Intercept] and [Trace]. Time spent in mocks can be measured only for the hooks, as
+mocks for [Override] are called directly by overridden function, so MockTime doesn't
+include them. Counters are atomic, so collecting them costs almost nothing.
+*/
+func Stats() PatchStats {
+	s := PatchStats{
+		Overrides:      stats.overrides.Load(),
+		PrologueWrites: stats.writes.Load(),
+		ProtectCalls:   stats.protects.Load(),
+		CacheFlushes:   stats.flushes.Load(),
+		PatchTime:      time.Duration(stats.patchNanos.Load()),
+		MockTime:       time.Duration(stats.mockNanos.Load()),
+		Calls:          map[string]int64{},
+	}
+	stats.calls.Range(func(key, value any) bool {
+		s.Calls[funcName(key.(unsafe.Pointer))] += value.(*atomic.Int64).Load()
+		return true
+	})
+
+	return s
+}
+
+/*
+WriteStats writes the summary of [Stats] in human-readable form to <w>, with functions ordered
+by number of calls.
+*/
+func WriteStats(w io.Writer) error {
+	s := Stats()
+	names := make([]string, 0, len(s.Calls))
+	for name := range s.Calls {
+		names = append(names, name)
+	}
+	sort.Slice(names, func(i, j int) bool {
+		if s.Calls[names[i]] != s.Calls[names[j]] {
+			return s.Calls[names[i]] > s.Calls[names[j]]
+		}
+		return names[i] < names[j]
+	})
+
+	_, err := fmt.Fprintf(w, "testaroli: %d overrides, %d prologue writes, %d protection calls, %d cache flushes\n"+
+		"testaroli: %v patching, %v in hooks\n",
+		s.Overrides, s.PrologueWrites, s.ProtectCalls, s.CacheFlushes, s.PatchTime, s.MockTime)
+	for _, name := range names {
+		if err != nil {
+			break
+		}
+		_, err = fmt.Fprintf(w, "testaroli: %10d %s\n", s.Calls[name], name)
+	}
+
+	return err
+}
+
+// countCall counts the call of overridden function, starting at <entry>
+func countCall(entry unsafe.Pointer) {
+	callCounter(entry).Add(1)
+}
+
+// callCounter returns the counter of calls of overridden function, starting at <entry>. Counters
+// are never removed, so native stubs can increment them
+func callCounter(entry unsafe.Pointer) *atomic.Int64 {
+	n, ok := stats.calls.Load(entry)
+	if !ok {
+		n, _ = stats.calls.LoadOrStore(entry, new(atomic.Int64))
+	}
+
+	return n.(*atomic.Int64)
+}
+
+// countMockTime counts time, spent in the hook, started at <start>
+func countMockTime(start time.Time) {
+	stats.mockNanos.Add(int64(time.Since(start)))
+}
+
+// countWrite counts the prologue write, started at <start>
+func countWrite(start time.Time) {
+	stats.writes.Add(1)
+	stats.patchNanos.Add(int64(time.Since(start)))
+}
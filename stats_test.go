@@ -0,0 +1,48 @@
+package testaroli
+
+import (
+	"bytes"
+	"strings"
+	"testing"
+)
+
+func TestStats(t *testing.T) {
+	before := Stats()
+
+	ctx := TestingContext(t)
+	bazs := Spy(ctx, baz)
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation().CheckArgs(i)
+		return nil
+	})(6)
+
+	testError(t, nil, foo(106))
+	testError(t, nil, ExpectationsWereMet())
+	if bazs.Calls() != 6 {
+		t.Errorf("unexpected number of calls %d", bazs.Calls())
+	}
+
+	after := Stats()
+	if after.Overrides-before.Overrides != 2 {
+		t.Errorf("unexpected number of overrides %d", after.Overrides-before.Overrides)
+	}
+	if after.PrologueWrites-before.PrologueWrites < 3 { // 2 overrides and reset of bar
+		t.Errorf("unexpected number of prologue writes %d", after.PrologueWrites-before.PrologueWrites)
+	}
+	if after.PatchTime <= before.PatchTime || after.MockTime < before.MockTime {
+		t.Errorf("unexpected times %v, %v", after.PatchTime, after.MockTime)
+	}
+	barName := "github.com/qrdl/testaroli.bar"
+	bazName := "github.com/qrdl/testaroli.baz"
+	if after.Calls[barName]-before.Calls[barName] != 1 || after.Calls[bazName]-before.Calls[bazName] != 6 {
+		t.Errorf("unexpected number of calls %v", after.Calls)
+	}
+
+	var buf bytes.Buffer
+	if err := WriteStats(&buf); err != nil {
+		t.Fatal(err)
+	}
+	if !strings.Contains(buf.String(), " overrides, ") || !strings.Contains(buf.String(), bazName) {
+		t.Errorf("unexpected stats:\n%s", buf.String())
+	}
+}
@@ -0,0 +1,140 @@
+package testaroli
+
+import (
+	"math"
+	"reflect"
+	"unsafe"
+)
+
+// number of float array/slice elements, checked for bit equality at once
+const floatBatch = 8
+
+/*
+Tolerance specifies how much floating-point values (including real and imaginary parts of
+complex values) may differ and still be considered equal by [Expect.CheckArgs]. Values are
+equal if they are within any of the set tolerances. Zero Tolerance means exact comparison.
+
+NaN is always considered equal to NaN, and infinity is equal only to infinity of the same sign.
+*/
+type Tolerance struct {
+	Abs float64 // max absolute difference
+	Rel float64 // max difference, relative to the larger of absolute values
+	ULP uint64  // max difference in units in the last place, for the type of values
+}
+
+/*
+WithTolerance sets the tolerance for comparing floating-point values with [Expect.CheckArgs],
+including the ones inside slices, structs etc., for example:
+
+	Override(ctx, filter, Once, func(samples []float64) []float64 {
+	    Expectation().WithTolerance(Tolerance{Rel: 1e-9}).CheckArgs(samples)
+	    return nil
+	})(expectedSamples)
+*/
+func (e *Expect) WithTolerance(tol Tolerance) *Expect {
+	e.tolerance = tol
+
+	return e
+}
+
+// floatEqual compares values with given tolerance, <bits> is the size of the type of values
+func (t Tolerance) floatEqual(a, e float64, bits int) bool {
+	if a == e || (math.IsNaN(a) && math.IsNaN(e)) {
+		return true
+	}
+	if math.IsNaN(a) || math.IsNaN(e) || math.IsInf(a, 0) || math.IsInf(e, 0) {
+		return false
+	}
+
+	diff := math.Abs(a - e)
+	if diff <= t.Abs || diff <= t.Rel*math.Max(math.Abs(a), math.Abs(e)) {
+		return true
+	}
+
+	return t.ULP > 0 && ulpDistance(a, e, bits) <= t.ULP
+}
+
+// ulpDistance returns the number of representable values of given size between <a> and <e>
+func ulpDistance(a, e float64, bits int) uint64 {
+	var oa, oe int64
+	if bits == 32 {
+		oa, oe = int64(orderedBits(math.Float32bits(float32(a)))), int64(orderedBits(math.Float32bits(float32(e))))
+	} else {
+		oa, oe = orderedBits(math.Float64bits(a)), orderedBits(math.Float64bits(e))
+	}
+	if oa > oe {
+		return uint64(oa) - uint64(oe)
+	}
+
+	return uint64(oe) - uint64(oa)
+}
+
+// orderedBits maps float bits to integers, which have the same order as floats
+func orderedBits[T uint32 | uint64](b T) int64 {
+	size := unsafe.Sizeof(b) * 8
+	if b>>(size-1) == 0 {
+		return int64(b)
+	}
+
+	// negative value - mirror it around zero, so -0 and +0 are next to each other
+	return -int64(b &^ (1 << (size - 1)))
+}
+
+/*
+firstFloatMismatch finds the first mismatching element of float arrays/slices without
+reflection: elements are checked for bit equality in batches, and only the batches
+which differ are compared with tolerance. It returns -1 if all elements are equal and false
+if values are not float arrays/slices or their memory is not accessible.
+*/
+func (c comparer) firstFloatMismatch(a, e reflect.Value, n int) (int, bool) {
+	kind := a.Type().Elem().Kind()
+	if kind != reflect.Float32 && kind != reflect.Float64 || comparatorFor(a.Type().Elem()) != nil {
+		return 0, false
+	}
+
+	var pa, pe unsafe.Pointer
+	switch {
+	case a.Kind() == reflect.Slice:
+		pa, pe = a.UnsafePointer(), e.UnsafePointer()
+	case a.CanAddr() && e.CanAddr():
+		pa, pe = a.Addr().UnsafePointer(), e.Addr().UnsafePointer()
+	default:
+		return 0, false
+	}
+
+	switch kind {
+	case reflect.Float64:
+		return firstMismatch(unsafe.Slice((*uint64)(pa), n), unsafe.Slice((*uint64)(pe), n), func(x, y uint64) bool {
+			return c.tol.floatEqual(math.Float64frombits(x), math.Float64frombits(y), 64)
+		}), true
+	case reflect.Float32:
+		return firstMismatch(unsafe.Slice((*uint32)(pa), n), unsafe.Slice((*uint32)(pe), n), func(x, y uint32) bool {
+			return c.tol.floatEqual(float64(math.Float32frombits(x)), float64(math.Float32frombits(y)), 32)
+		}), true
+	}
+
+	return 0, false
+}
+
+func firstMismatch[T uint32 | uint64](a, e []T, eq func(T, T) bool) int {
+	i := 0
+	for ; i+floatBatch <= len(a); i += floatBatch {
+		a, e := a[i:i+floatBatch], e[i:i+floatBatch]
+		if (a[0]^e[0])|(a[1]^e[1])|(a[2]^e[2])|(a[3]^e[3])|
+			(a[4]^e[4])|(a[5]^e[5])|(a[6]^e[6])|(a[7]^e[7]) == 0 {
+			continue
+		}
+		for j := range a {
+			if a[j] != e[j] && !eq(a[j], e[j]) {
+				return i + j
+			}
+		}
+	}
+	for ; i < len(a); i++ {
+		if a[i] != e[i] && !eq(a[i], e[i]) {
+			return i
+		}
+	}
+
+	return -1
+}
@@ -0,0 +1,105 @@
+package testaroli
+
+import (
+	"math"
+	"reflect"
+	"strings"
+	"testing"
+)
+
+func scale(samples []float64, k float64) float64 {
+	var sum float64
+	for i := range samples {
+		samples[i] *= k
+		sum += samples[i]
+	}
+	return sum
+}
+
+func process(samples []float64) float64 {
+	return scale(samples, 1.0/3)
+}
+
+func TestFloatTolerance(t *testing.T) {
+	nan, inf := math.NaN(), math.Inf(1)
+	cases := []struct {
+		name   string
+		tol    Tolerance
+		a, e   float64
+		bits   int
+		result bool
+	}{
+		{"exact", Tolerance{}, 1.5, 1.5, 64, true},
+		{"differ", Tolerance{}, 1.5, 1.5000001, 64, false},
+		{"zeros", Tolerance{}, 0, math.Copysign(0, -1), 64, true},
+		{"NaN", Tolerance{}, nan, nan, 64, true},
+		{"NaN and number", Tolerance{Abs: inf}, nan, 1, 64, false},
+		{"infinities", Tolerance{}, inf, inf, 64, true},
+		{"opposite infinities", Tolerance{Abs: inf}, inf, -inf, 64, false},
+		{"abs", Tolerance{Abs: 0.01}, 1, 1.009, 64, true},
+		{"abs exceeded", Tolerance{Abs: 0.01}, 1, 1.011, 64, false},
+		{"rel", Tolerance{Rel: 1e-6}, 1e9, 1e9 + 999, 64, true},
+		{"rel exceeded", Tolerance{Rel: 1e-6}, 1e9, 1e9 + 1001, 64, false},
+		{"ulp", Tolerance{ULP: 2}, 1, math.Nextafter(math.Nextafter(1, 2), 2), 64, true},
+		{"ulp exceeded", Tolerance{ULP: 1}, 1, math.Nextafter(math.Nextafter(1, 2), 2), 64, false},
+		{"ulp around zero", Tolerance{ULP: 2}, math.SmallestNonzeroFloat64, -math.SmallestNonzeroFloat64, 64, true},
+		{"ulp float32", Tolerance{ULP: 1}, 1, float64(math.Nextafter32(1, 2)), 32, true},
+	}
+
+	for _, c := range cases {
+		if c.tol.floatEqual(c.a, c.e, c.bits) != c.result {
+			t.Errorf("case '%s' result mismatched", c.name)
+		}
+	}
+}
+
+func TestFloatSlices(t *testing.T) {
+	const size = 1_000_000
+	actual := make([]float64, size)
+	expected := make([]float64, size)
+	for i := range actual {
+		actual[i] = float64(i) / 3
+		expected[i] = actual[i]
+	}
+	expected[5] = math.NaN()
+	actual[5] = math.NaN()
+
+	c := comparer{tol: Tolerance{Abs: 1e-6}}
+	if res, msg := c.equal(reflect.ValueOf(actual), reflect.ValueOf(expected)); !res {
+		t.Errorf("equal slices mismatched: %s", msg)
+	}
+
+	expected[size-10] += 1e-7
+	if res, msg := c.equal(reflect.ValueOf(actual), reflect.ValueOf(expected)); !res {
+		t.Errorf("slices within tolerance mismatched: %s", msg)
+	}
+
+	expected[size-3] += 1e-5
+	res, msg := c.equal(reflect.ValueOf(actual), reflect.ValueOf(expected))
+	if res || !strings.HasPrefix(msg, "slice elem 999997:") {
+		t.Errorf("unexpected result %v, message '%s'", res, msg)
+	}
+
+	// float32 array inside struct
+	type samples struct {
+		Values [10]float32
+	}
+	a, e := samples{}, samples{}
+	e.Values[9] = math.Nextafter32(0, 1)
+	if res, _ := (comparer{}).equal(reflect.ValueOf(a), reflect.ValueOf(e)); res {
+		t.Errorf("different arrays matched")
+	}
+	if res, msg := (comparer{tol: Tolerance{ULP: 1}}).equal(reflect.ValueOf(&a), reflect.ValueOf(&e)); !res {
+		t.Errorf("arrays within tolerance mismatched: %s", msg)
+	}
+}
+
+func TestWithTolerance(t *testing.T) {
+	Override(TestingContext(t), scale, Once, func(samples []float64, k float64) float64 {
+		Expectation().WithTolerance(Tolerance{Rel: 1e-12}).CheckArgs(samples, k)
+		return 0
+	})([]float64{0.1, 0.2}, 0.333333333333333)
+
+	process([]float64{0.1, 0.2})
+	testError(t, nil, ExpectationsWereMet())
+}
@@ -0,0 +1,276 @@
+package testaroli
+
+import (
+	"bufio"
+	"context"
+	"encoding/json"
+	"io"
+	"reflect"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+	"unsafe"
+)
+
+/*
+Tracer records calls of traced functions. See [Trace] for details.
+*/
+type Tracer struct {
+	start   time.Time
+	names   []string
+	shards  []traceShard // one per processor
+	patches []*patch
+}
+
+// traceShard is the buffer of events, recorded on one processor, so hooks, running in parallel,
+// don't contend for the same counter
+type traceShard struct {
+	events atomic.Pointer[[]traceEvent] // allocated on first use
+	next   atomic.Int64
+	_      [48]byte // pad to cache line
+}
+
+type traceEvent struct {
+	fn     int     // index in Tracer.names
+	g      uintptr // goroutine, see currentG
+	caller uintptr // PC of the call
+	start  int64   // nanoseconds since tracer start
+	end    int64   // nanoseconds since tracer start
+	done   atomic.Bool
+}
+
+// TraceBufferSize is the max number of calls, recorded by [Tracer] on each processor, the rest are dropped
+var TraceBufferSize = 1 << 16
+
+/*
+Trace patches functions <fns> to record every call - its start and end time, the goroutine
+and the caller, and then call the original function. Recorded calls can be exported with
+[Tracer.WriteChromeTrace] and viewed in chrome://tracing or Perfetto UI:
+
+	func TestHandler(t *testing.T) {
+	    tracer := Trace(TestingContext(t), parseRequest, db.Query, (*Cache).Get)
+
+	    handler(req)
+
+	    f, _ := os.Create("trace.json")
+	    defer f.Close()
+	    tracer.WriteChromeTrace(f)
+	}
+
+Calls are recorded without locking into per-processor buffers of [TraceBufferSize] events,
+calls which don't fit into buffer are dropped. Original function is called through the
+trampoline, so calls from different goroutines run in parallel, and recursive calls are
+recorded too.
+
+Original functions are restored when test, which context is passed to Trace, completes.
+Like with [Override], it is necessary to disable function inlining to make Trace work.
+*/
+func Trace(ctx context.Context, fns ...any) *Tracer {
+	t := Testing(ctx)
+
+	tr := &Tracer{
+		start:  time.Now(),
+		shards: make([]traceShard, runtime.GOMAXPROCS(0)),
+	}
+	for i, fn := range fns {
+		tr.names = append(tr.names, runtime.FuncForPC(reflect.ValueOf(fn).Pointer()).Name())
+		tr.patches = append(tr.patches, newHook(fn, tr.hook(i)))
+	}
+
+	t.Cleanup(func() {
+		for _, p := range tr.patches {
+			p.remove()
+		}
+	})
+
+	return tr
+}
+
+func (tr *Tracer) hook(fn int) hookFunc {
+	return func(p *patch, args []reflect.Value) []reflect.Value {
+		ev := tr.event()
+		if ev == nil {
+			return p.call(args) // buffer is full
+		}
+		ev.fn = fn
+		ev.g = currentG()
+		ev.caller = hookCaller()
+		ev.start = int64(time.Since(tr.start))
+
+		res := p.call(args)
+
+		ev.end = int64(time.Since(tr.start))
+		ev.done.Store(true)
+
+		return res
+	}
+}
+
+// event returns the event in the buffer of current processor, or nil, if buffer is full
+func (tr *Tracer) event() *traceEvent {
+	// GOMAXPROCS can be changed after Trace is called
+	shard := &tr.shards[procPin()%len(tr.shards)]
+	idx := shard.next.Add(1) - 1
+	procUnpin()
+	if idx >= int64(TraceBufferSize) {
+		return nil
+	}
+
+	events := shard.events.Load()
+	if events == nil {
+		buf := make([]traceEvent, TraceBufferSize)
+		shard.events.CompareAndSwap(nil, &buf)
+		events = shard.events.Load()
+	}
+	if idx >= int64(len(*events)) { // TraceBufferSize was changed
+		return nil
+	}
+
+	return &(*events)[idx]
+}
+
+//go:linkname procPin runtime.procPin
+func procPin() int
+
+//go:linkname procUnpin runtime.procUnpin
+func procUnpin()
+
+/*
+Calls returns the number of recorded calls for each of traced functions, by function name.
+Calls, which are still in progress, are not counted.
+*/
+func (tr *Tracer) Calls() map[string]int {
+	calls := map[string]int{}
+	for _, ev := range tr.recorded() {
+		calls[tr.names[ev.fn]]++
+	}
+
+	return calls
+}
+
+/*
+WriteChromeTrace writes recorded calls in Chrome Trace Event format, which is understood
+by chrome://tracing and Perfetto UI.
+*/
+func (tr *Tracer) WriteChromeTrace(w io.Writer) error {
+	type event struct {
+		Name string            `json:"name"`
+		Ph   string            `json:"ph"`
+		Ts   float64           `json:"ts"`  // microseconds
+		Dur  float64           `json:"dur"` // microseconds
+		Pid  int               `json:"pid"`
+		Tid  uint64            `json:"tid"`
+		Args map[string]string `json:"args,omitempty"`
+	}
+
+	var trace struct {
+		TraceEvents []event `json:"traceEvents"`
+	}
+	trace.TraceEvents = []event{} // never encode as null
+	tids := map[uintptr]uint64{}  // goroutines are numbered in order of their first call
+	for _, ev := range tr.recorded() {
+		tid, ok := tids[ev.g]
+		if !ok {
+			tid = uint64(len(tids) + 1)
+			tids[ev.g] = tid
+		}
+		e := event{
+			Name: tr.names[ev.fn],
+			Ph:   "X", // complete event
+			Ts:   float64(ev.start) / 1e3,
+			Dur:  float64(ev.end-ev.start) / 1e3,
+			Pid:  1,
+			Tid:  tid,
+		}
+		if f := runtime.FuncForPC(ev.caller); f != nil {
+			file, line := f.FileLine(ev.caller)
+			e.Args = map[string]string{"caller": f.Name() + " " + file + ":" + strconv.Itoa(line)}
+		}
+		trace.TraceEvents = append(trace.TraceEvents, e)
+	}
+
+	bw := bufio.NewWriter(w)
+	if err := json.NewEncoder(bw).Encode(trace); err != nil {
+		return err
+	}
+	return bw.Flush()
+}
+
+// recorded returns completed calls in order of their start
+func (tr *Tracer) recorded() []*traceEvent {
+	var events []*traceEvent
+	for i := range tr.shards {
+		buf := tr.shards[i].events.Load()
+		if buf == nil {
+			continue
+		}
+		count := min(tr.shards[i].next.Load(), int64(len(*buf)))
+		for j := int64(0); j < count; j++ {
+			if ev := &(*buf)[j]; ev.done.Load() {
+				events = append(events, ev)
+			}
+		}
+	}
+	sort.SliceStable(events, func(i, j int) bool { return events[i].start < events[j].start })
+
+	return events
+}
+
+// name of the function, which runs the hook, see hookCaller
+var hookRunnerName = runtime.FuncForPC(reflect.ValueOf((*patch).runHook).Pointer()).Name()
+
+// hookCaller returns PC of the call of the hooked function, must be called from the hook
+func hookCaller() uintptr {
+	var pcs [16]uintptr
+	n := runtime.Callers(1, pcs[:])
+	frames := runtime.CallersFrames(pcs[:n])
+	for more := true; more; {
+		var frame runtime.Frame
+		frame, more = frames.Next()
+		if frame.Function != hookRunnerName {
+			continue
+		}
+		// hooked function jumps to the hook, so its caller is the first frame above patch.runHook,
+		// which isn't the wrapper of its method value or reflect's frame
+		for more {
+			frame, more = frames.Next()
+			if frame.Function != hookRunnerName+"-fm" && !strings.HasPrefix(frame.Function, "reflect.") {
+				return frame.PC
+			}
+		}
+	}
+
+	return 0
+}
+
+var (
+	currentGOnce sync.Once
+	currentGFunc func() uintptr
+)
+
+/*
+currentG returns the pointer to runtime's g of current goroutine, which identifies the goroutine
+without parsing its ID from the stack trace. The register, which keeps g, isn't accessible from
+Go, so the function, which returns it, is generated on the first call. g of exited goroutine can
+be reused by the new one, so goroutines, which don't run at the same time, may have the same g.
+*/
+func currentG() uintptr {
+	currentGOnce.Do(func() {
+		code, err := placeCode(reflect.ValueOf(currentG).Pointer(), func(a *asm) error {
+			a.returnG()
+			return nil
+		})
+		if err != nil {
+			panic(err)
+		}
+		// function value is a pointer to the closure object, which starts with the code pointer
+		entry := &code
+		*(*unsafe.Pointer)(unsafe.Pointer(&currentGFunc)) = unsafe.Pointer(entry)
+	})
+
+	return currentGFunc()
+}
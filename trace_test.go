@@ -0,0 +1,127 @@
+package testaroli
+
+import (
+	"bytes"
+	"encoding/json"
+	"strings"
+	"sync"
+	"testing"
+)
+
+func TestTrace(t *testing.T) {
+	tracer := Trace(TestingContext(t), bar, qux)
+
+	testError(t, nil, foo(1))
+	testError(t, nil, foo(1))
+
+	calls := tracer.Calls()
+	if calls["github.com/qrdl/testaroli.bar"] != 2 || calls["github.com/qrdl/testaroli.qux"] != 2 {
+		t.Errorf("unexpected calls %v", calls)
+	}
+
+	var buf bytes.Buffer
+	testError(t, nil, tracer.WriteChromeTrace(&buf))
+	var trace struct {
+		TraceEvents []struct {
+			Name string
+			Ts   float64
+			Dur  float64
+			Tid  uint64
+			Args map[string]string
+		}
+	}
+	testError(t, nil, json.Unmarshal(buf.Bytes(), &trace))
+	if len(trace.TraceEvents) != 4 {
+		t.Fatalf("unexpected number of events %d", len(trace.TraceEvents))
+	}
+	outer, inner := trace.TraceEvents[0], trace.TraceEvents[1]
+	if outer.Name != "github.com/qrdl/testaroli.bar" || inner.Name != "github.com/qrdl/testaroli.qux" {
+		t.Errorf("unexpected order of events %s, %s", outer.Name, inner.Name)
+	}
+	if inner.Ts < outer.Ts || inner.Ts+inner.Dur > outer.Ts+outer.Dur {
+		t.Errorf("nested call isn't within outer call")
+	}
+	if outer.Tid == 0 || outer.Tid != inner.Tid {
+		t.Errorf("unexpected goroutine IDs %d, %d", outer.Tid, inner.Tid)
+	}
+	if !strings.HasPrefix(outer.Args["caller"], "github.com/qrdl/testaroli.foo ") {
+		t.Errorf("unexpected caller %s", outer.Args["caller"])
+	}
+	if !strings.HasPrefix(inner.Args["caller"], "github.com/qrdl/testaroli.bar ") {
+		t.Errorf("unexpected caller %s", inner.Args["caller"])
+	}
+}
+
+func TestTraceConcurrent(t *testing.T) {
+	tracer := Trace(TestingContext(t), fact)
+
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for j := 0; j < 1000; j++ {
+				fact(3)
+			}
+		}()
+	}
+	wg.Wait()
+
+	// recursive calls are recorded too
+	if calls := tracer.Calls()["github.com/qrdl/testaroli.fact"]; calls != 8*1000*3 {
+		t.Errorf("unexpected number of calls %d", calls)
+	}
+}
+
+func TestTraceRestore(t *testing.T) {
+	var tracer *Tracer
+	t.Run("traced", func(t *testing.T) {
+		tracer = Trace(TestingContext(t), bar)
+	})
+
+	testError(t, nil, foo(1))
+	if len(tracer.Calls()) != 0 {
+		t.Errorf("call recorded after tracer was removed")
+	}
+}
+
+func TestTraceGoroutines(t *testing.T) {
+	tracer := Trace(TestingContext(t), baz)
+
+	// goroutines run at the same time, so they are different
+	var started, done sync.WaitGroup
+	started.Add(4)
+	done.Add(4)
+	for i := 0; i < 4; i++ {
+		go func() {
+			defer done.Done()
+			baz(1)
+			started.Done()
+			started.Wait()
+			baz(2)
+		}()
+	}
+	done.Wait()
+
+	var buf bytes.Buffer
+	testError(t, nil, tracer.WriteChromeTrace(&buf))
+	var trace struct {
+		TraceEvents []struct {
+			Tid uint64
+		}
+	}
+	testError(t, nil, json.Unmarshal(buf.Bytes(), &trace))
+	calls := map[uint64]int{}
+	for _, ev := range trace.TraceEvents {
+		calls[ev.Tid]++
+	}
+	if len(calls) != 4 {
+		t.Errorf("unexpected goroutines %v", calls)
+	}
+	for tid, n := range calls {
+		if tid == 0 || n != 2 {
+			t.Errorf("unexpected goroutines %v", calls)
+			break
+		}
+	}
+}
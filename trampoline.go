@@ -0,0 +1,255 @@
+package testaroli
+
+import (
+	"fmt"
+	"sync"
+	"unsafe"
+)
+
+/*
+Trampolines let patched code call the original function without restoring its prologue, so
+the patch stays in effect for other goroutines. Trampoline is the copy of the instructions,
+overwritten by the patch, adjusted to run at the new address, followed by the jump to the rest
+of the original function. It also repeats the stack check of the original function, as it is
+called instead of the function's entry. Trampolines and stubs, which patched code jumps to, are
+placed into executable memory near the code, so they can be reached with relative jumps.
+*/
+
+/*
+trampolineCall is the closure object, which is called as the function value: the trampoline
+finds it in the closure context register. Trampoline can't grow the stack, like Go functions
+do, so if the stack check fails, it sets failed and returns zero results.
+*/
+type trampolineCall struct {
+	code   uintptr
+	failed bool
+}
+
+// code is generated with the address, where it is written, known in advance
+type asm struct {
+	base uintptr
+	code []byte
+}
+
+// pc returns the address of the next instruction
+func (a *asm) pc() uintptr {
+	return a.base + uintptr(len(a.code))
+}
+
+func (a *asm) emit(code ...byte) {
+	a.code = append(a.code, code...)
+}
+
+// executable memory for trampolines and stubs, it is never freed, as other goroutines may
+// still execute the code after the patch is removed
+var codeArena struct {
+	mu     sync.Mutex
+	chunks []*codeChunk
+}
+
+type codeChunk struct {
+	start uintptr
+	end   uintptr
+	next  uintptr // first free byte
+}
+
+const (
+	codeChunkSize = 64 << 10
+	codeAlign     = 16
+	maxCodeSize   = 512 // max size of the single trampoline or stub
+)
+
+// call-through trampolines are the same for every patch of the function, so they are reused
+var (
+	trampolinesMu sync.Mutex
+	trampolines   = map[trampolineKey]uintptr{}
+)
+
+type trampolineKey struct {
+	org  uintptr
+	from int // offset of the first overwritten byte
+	size int // number of overwritten bytes
+}
+
+// placeCode writes the code, generated by <gen> for its address, into executable memory
+// within the reach of relative jumps from <near>
+func placeCode(near uintptr, gen func(a *asm) error) (uintptr, error) {
+	addr, err := allocCode(near, maxCodeSize)
+	if err != nil {
+		return 0, err
+	}
+	a := &asm{base: addr}
+	if err := gen(a); err != nil {
+		return 0, err
+	}
+	if len(a.code) > maxCodeSize {
+		panic("generated code is too long") // should never happen
+	}
+	writeCode(codePointer(addr), a.code) // OS-specific
+	syncCode(codePointer(addr), len(a.code))
+
+	codeArena.mu.Lock()
+	defer codeArena.mu.Unlock()
+	// give back the unused part of allocation, if nothing was allocated after it
+	for _, c := range codeArena.chunks {
+		if c.next == addr+maxCodeSize {
+			c.next = addr + alignUp(uintptr(len(a.code)), codeAlign)
+		}
+	}
+
+	return addr, nil
+}
+
+// allocCode returns <size> bytes of executable memory within the reach of relative jumps from <near>
+func allocCode(near uintptr, size uintptr) (uintptr, error) {
+	codeArena.mu.Lock()
+	defer codeArena.mu.Unlock()
+
+	for _, c := range codeArena.chunks {
+		if c.next+size <= c.end && inReach(near, c.start, c.end) {
+			addr := c.next
+			c.next += size
+			return addr, nil
+		}
+	}
+
+	start, err := mapCodeNear(near, codeChunkSize)
+	if err != nil {
+		return 0, err
+	}
+	c := &codeChunk{start: start, end: start + codeChunkSize, next: start + size}
+	codeArena.chunks = append(codeArena.chunks, c)
+
+	return start, nil
+}
+
+// mapCodeNear maps executable memory, trying the addresses around <near>, and, if there is no
+// free space nearby, anywhere
+func mapCodeNear(near, size uintptr) (uintptr, error) {
+	const step = 1 << 20
+	base := near &^ (step - 1)
+	for i := uintptr(1); i*step < codeReach; i++ {
+		for _, hint := range []uintptr{base + i*step, base - i*step} {
+			if hint > base+i*step || hint < step { // wrapped around
+				continue
+			}
+			addr, err := mapCode(hint, size) // OS-specific
+			if err != nil {
+				continue // area is taken
+			}
+			if inReach(near, addr, addr+size) {
+				return addr, nil
+			}
+			unmapCode(addr, size)
+		}
+	}
+
+	return mapCode(0, size)
+}
+
+// inReach reports whether memory area from <start> to <end> can be reached from <addr> with relative jumps
+func inReach(addr, start, end uintptr) bool {
+	return max(addr, end)-min(addr, start) < codeReach
+}
+
+// codePointer converts the address of the code, which isn't managed by Go, to the pointer
+func codePointer(addr uintptr) unsafe.Pointer {
+	return *(*unsafe.Pointer)(unsafe.Pointer(&addr))
+}
+
+func alignUp(n, align uintptr) uintptr {
+	return (n + align - 1) &^ (align - 1)
+}
+
+/*
+callThrough returns the trampoline, which calls the original function at <org>, which is
+overwritten from offset <from> for <size> bytes. Trampoline repeats the stack check of the
+function and returns with failed trampolineCall, if the check fails.
+*/
+func callThrough(org unsafe.Pointer, from, size int) (uintptr, error) {
+	key := trampolineKey{org: uintptr(org), from: from, size: size}
+
+	trampolinesMu.Lock()
+	defer trampolinesMu.Unlock()
+	if code, ok := trampolines[key]; ok {
+		return code, nil
+	}
+
+	end, err := displacedEnd(uintptr(org), from, size)
+	if err != nil {
+		return 0, err
+	}
+	if err := checkBranchTargets(uintptr(org), from, end); err != nil {
+		return 0, err
+	}
+	checkLen := stackCheckLength(uintptr(org))
+	code, err := placeCode(uintptr(org), func(a *asm) error {
+		return a.callThrough(uintptr(org), checkLen, max(from, checkLen), max(end, checkLen))
+	})
+	if err != nil {
+		return 0, err
+	}
+	trampolines[key] = code
+
+	return code, nil
+}
+
+// resume appends the code, which continues function <org> from offset <from>, which is
+// overwritten with <size> bytes. It doesn't repeat the stack check, as the stub, which uses it,
+// is called from the patched function after the check.
+func (a *asm) resume(org unsafe.Pointer, from, size int) error {
+	end, err := displacedEnd(uintptr(org), from, size)
+	if err != nil {
+		return err
+	}
+	if err := checkBranchTargets(uintptr(org), from, end); err != nil {
+		return err
+	}
+
+	return a.relocate(uintptr(org), from, end)
+}
+
+// maxStackGrowth limits the stack, reserved for the trampoline, which repeatedly fails the stack check
+const maxStackGrowth = 64 << 20
+
+/*
+original calls <call> with function value <org>, which calls the original function of patch
+<p> through the trampoline. If trampoline couldn't call the original function, because the
+stack check failed, <call> is repeated after the stack is grown. Results of the original
+function must be passed in registers, as only registers are zeroed by failed trampoline.
+*/
+func original[T any](p *patch, call func(org T)) {
+	p.callOriginal(func(fn unsafe.Pointer) {
+		call(*(*T)(fn))
+	})
+}
+
+// callOriginal calls <call> with the pointer to function value, which calls the original function
+func (p *patch) callOriginal(call func(fn unsafe.Pointer)) {
+	code := p.trampoline()
+	for size := 1 << 10; ; size *= 2 {
+		tc := &trampolineCall{code: code}
+		call(unsafe.Pointer(&tc))
+		if !tc.failed {
+			return
+		}
+		// stack check fails, when the stack is too short or goroutine is asked to yield, so
+		// calling Go function handles both
+		if size > maxStackGrowth {
+			panic(fmt.Sprintf("cannot call original function %s", funcName(p.orgAddr)))
+		}
+		growStack(size)
+	}
+}
+
+// growStack uses at least <size> bytes of the stack, so after it returns, the stack is large enough
+//
+//go:noinline
+func growStack(size int) byte {
+	var buf [1024]byte
+	if size > len(buf) {
+		buf[size%len(buf)] = growStack(size - len(buf))
+	}
+
+	return buf[size%len(buf)]
+}
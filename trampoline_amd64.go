@@ -0,0 +1,550 @@
+package testaroli
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"runtime"
+	"unsafe"
+)
+
+// trampolines are reached with 32-bit relative jumps and they access data of the program with
+// 32-bit displacements, so they are kept within 1GB from the code, leaving the rest for the data
+const codeReach = 1 << 30
+
+// max length of x86 instruction
+const maxInstrLength = 15
+
+// patch of the function entry is JMP rel32
+const entryJmpLength = jmpInstrLength
+
+// kinds of x86 instructions, which need adjusting when moved to other address
+const (
+	x86Plain        = iota
+	x86RIPRelative  // memory operand is relative to the instruction pointer
+	x86Jmp          // relative JMP
+	x86Jcc          // relative conditional jump
+	x86Call         // relative CALL
+	x86CallIndirect // CALL with register or memory operand
+	x86Loop         // LOOP and JCXZ, which have only 8-bit displacement
+)
+
+// x86Instr holds properties of x86 instruction, needed to move it to other address
+type x86Instr struct {
+	length int
+	kind   int
+	rel    int  // offset of relative displacement
+	relLen int  // length of relative displacement
+	cond   byte // condition of conditional jump
+	modrm  int  // offset of ModRM byte, if instruction has it
+}
+
+var errUnknownInstr = errors.New("unknown instruction")
+
+/*
+decodeInstr decodes x86-64 instruction at the start of <code>. It decodes only the length and
+the operands, which are relative to the instruction pointer, so instructions of the same
+format are not told apart.
+*/
+func decodeInstr(code []byte) (x86Instr, error) {
+	in := x86Instr{modrm: -1}
+	i := 0
+	next := func() (byte, error) {
+		if i >= len(code) || i >= maxInstrLength {
+			return 0, errUnknownInstr
+		}
+		i++
+		return code[i-1], nil
+	}
+
+	// legacy prefixes
+	opSize16, addrSize32 := false, false
+	var op byte
+	for {
+		b, err := next()
+		if err != nil {
+			return in, err
+		}
+		if b == 0x66 {
+			opSize16 = true
+		} else if b == 0x67 {
+			addrSize32 = true
+		} else if b != 0xF0 && b != 0xF2 && b != 0xF3 && b != 0x2E && b != 0x36 && b != 0x3E && b != 0x26 && b != 0x64 && b != 0x65 {
+			op = b
+			break
+		}
+	}
+	rexW := false
+	if op&0xF0 == 0x40 { // REX
+		rexW = op&0x08 != 0
+		b, err := next()
+		if err != nil {
+			return in, err
+		}
+		op = b
+	}
+
+	immZ := 4 // immediate of operand size, which is 32 bit for 64-bit operand too
+	if opSize16 {
+		immZ = 2
+	}
+	modrm, imm := false, 0
+	switch {
+	case op == 0x0F:
+		op2, err := next()
+		if err != nil {
+			return in, err
+		}
+		switch {
+		case op2 == 0x38:
+			if _, err := next(); err != nil {
+				return in, err
+			}
+			modrm = true
+		case op2 == 0x3A:
+			if _, err := next(); err != nil {
+				return in, err
+			}
+			modrm, imm = true, 1
+		case op2 >= 0x80 && op2 <= 0x8F:
+			in.kind, in.cond, in.rel, in.relLen = x86Jcc, op2&0x0F, i, 4
+			imm = 4
+		case op2 == 0x05 || op2 == 0x06 || op2 == 0x07 || op2 == 0x08 || op2 == 0x09 || op2 == 0x0B ||
+			op2 == 0x0E || op2 >= 0x30 && op2 <= 0x37 || op2 == 0x77 || op2 == 0xA0 || op2 == 0xA1 ||
+			op2 == 0xA2 || op2 == 0xA8 || op2 == 0xA9 || op2 == 0xAA || op2 >= 0xC8 && op2 <= 0xCF:
+			// no operands
+		case op2 >= 0x70 && op2 <= 0x73 || op2 == 0xA4 || op2 == 0xAC || op2 == 0xBA || op2 == 0xC2 ||
+			op2 >= 0xC4 && op2 <= 0xC6 || op2 == 0x0F:
+			modrm, imm = true, 1
+		default:
+			modrm = true
+		}
+	case op == 0xC4 || op == 0xC5: // VEX
+		vexMap := byte(1)
+		if op == 0xC4 {
+			b, err := next()
+			if err != nil {
+				return in, err
+			}
+			vexMap = b & 0x1F
+		}
+		if _, err := next(); err != nil {
+			return in, err
+		}
+		op2, err := next()
+		if err != nil {
+			return in, err
+		}
+		switch vexMap {
+		case 1:
+			if op2 == 0x77 { // VZEROUPPER, VZEROALL
+				break
+			}
+			modrm = true
+			if op2 >= 0x70 && op2 <= 0x73 || op2 == 0xC2 || op2 >= 0xC4 && op2 <= 0xC6 {
+				imm = 1
+			}
+		case 2:
+			modrm = true
+		case 3:
+			modrm, imm = true, 1
+		default:
+			return in, errUnknownInstr
+		}
+	case op < 0x40:
+		switch op & 7 {
+		case 0, 1, 2, 3:
+			modrm = true
+		case 4:
+			imm = 1
+		case 5:
+			imm = immZ
+		default: // segment pushes/pops and BCD instructions are invalid in 64-bit mode
+			return in, errUnknownInstr
+		}
+	case op >= 0x50 && op <= 0x5F || op >= 0x6C && op <= 0x6F || op >= 0x90 && op <= 0x99 || op >= 0x9B && op <= 0x9F ||
+		op >= 0xA4 && op <= 0xA7 || op >= 0xAA && op <= 0xAF || op == 0xC3 || op == 0xC9 || op == 0xCB ||
+		op == 0xCC || op == 0xCF || op == 0xD7 || op >= 0xEC && op <= 0xEF || op == 0xF1 || op == 0xF4 ||
+		op == 0xF5 || op >= 0xF8 && op <= 0xFD:
+		// no operands
+	case op == 0x63 || op >= 0x84 && op <= 0x8F || op >= 0xD0 && op <= 0xD3 || op >= 0xD8 && op <= 0xDF || op == 0xFE:
+		modrm = true
+	case op == 0x68:
+		imm = immZ
+	case op == 0x69 || op == 0x81 || op == 0xC7:
+		modrm, imm = true, immZ
+	case op == 0x6A || op == 0xA8 || op >= 0xB0 && op <= 0xB7 || op == 0xCD || op >= 0xE4 && op <= 0xE7:
+		imm = 1
+	case op == 0x6B || op == 0x80 || op == 0x83 || op == 0xC0 || op == 0xC1 || op == 0xC6:
+		modrm, imm = true, 1
+	case op >= 0x70 && op <= 0x7F:
+		in.kind, in.cond, in.rel, in.relLen = x86Jcc, op&0x0F, i, 1
+		imm = 1
+	case op >= 0xA0 && op <= 0xA3: // MOV with absolute address
+		imm = 8
+		if addrSize32 {
+			imm = 4
+		}
+	case op == 0xA9:
+		imm = immZ
+	case op >= 0xB8 && op <= 0xBF:
+		imm = immZ
+		if rexW {
+			imm = 8
+		}
+	case op == 0xC2 || op == 0xCA:
+		imm = 2
+	case op == 0xC8:
+		imm = 3
+	case op >= 0xE0 && op <= 0xE3:
+		in.kind, in.rel, in.relLen = x86Loop, i, 1
+		imm = 1
+	case op == 0xE8:
+		in.kind, in.rel, in.relLen = x86Call, i, 4
+		imm = 4
+	case op == 0xE9:
+		in.kind, in.rel, in.relLen = x86Jmp, i, 4
+		imm = 4
+	case op == 0xEB:
+		in.kind, in.rel, in.relLen = x86Jmp, i, 1
+		imm = 1
+	case op == 0xF6 || op == 0xF7:
+		modrm = true
+		if i < len(code) && code[i]>>3&7 < 2 { // TEST has immediate, other instructions of the group don't
+			imm = 1
+			if op == 0xF7 {
+				imm = immZ
+			}
+		}
+	case op == 0xFF:
+		modrm = true
+		if i < len(code) && (code[i]>>3&7 == 2 || code[i]>>3&7 == 3) {
+			in.kind = x86CallIndirect
+		}
+	default:
+		return in, errUnknownInstr
+	}
+
+	if modrm {
+		in.modrm = i
+		m, err := next()
+		if err != nil {
+			return in, err
+		}
+		mod, rm := m>>6, m&7
+		disp := 0
+		if mod != 3 && rm == 4 {
+			sib, err := next()
+			if err != nil {
+				return in, err
+			}
+			if mod == 0 && sib&7 == 5 {
+				disp = 4
+			}
+		}
+		switch {
+		case mod == 0 && rm == 5:
+			if in.kind == x86Plain {
+				in.kind = x86RIPRelative
+			}
+			in.rel, in.relLen = i, 4
+			disp = 4
+		case mod == 1:
+			disp = 1
+		case mod == 2:
+			disp = 4
+		}
+		i += disp
+	}
+	i += imm
+	if i > len(code) || i > maxInstrLength {
+		return in, errUnknownInstr
+	}
+	in.length = i
+
+	return in, nil
+}
+
+// instrAt decodes instruction at <addr>
+func instrAt(addr uintptr) (x86Instr, []byte, error) {
+	code := unsafe.Slice((*byte)(codePointer(addr)), maxInstrLength)
+	in, err := decodeInstr(code)
+	if err != nil {
+		return in, nil, fmt.Errorf("%w at %s+%#x", err, runtime.FuncForPC(addr).Name(), addr-runtime.FuncForPC(addr).Entry())
+	}
+
+	return in, code[:in.length], nil
+}
+
+// relTarget returns the target of relative operand of the instruction at <addr>
+func (in x86Instr) relTarget(addr uintptr, code []byte) uintptr {
+	var rel int64
+	if in.relLen == 1 {
+		rel = int64(int8(code[in.rel]))
+	} else {
+		rel = int64(int32(binary.LittleEndian.Uint32(code[in.rel:])))
+	}
+
+	return uintptr(int64(addr) + int64(in.length) + rel)
+}
+
+/*
+stackCheckLength returns the length of the stack check at the start of Go function <org>, or
+zero, if function doesn't check the stack. Stack check compares stack pointer, or, for large
+frames, the stack pointer minus frame size, with the stack guard of the goroutine, and jumps
+to the code, which grows the stack, if it's too short:
+
+	CMPQ SP, 16(R14)     or     LEAQ -framesize(SP), R12     or     MOVQ SP, R12
+	JLS  morestack              CMPQ R12, 16(R14)                   SUBQ $framesize, R12
+	                            JLS  morestack                      JCS  morestack
+	                                                                CMPQ R12, 16(R14)
+	                                                                JLS  morestack
+*/
+func stackCheckLength(org uintptr) int {
+	off := 0
+	for n := 0; n < 5; n++ {
+		in, code, err := instrAt(org + uintptr(off))
+		if err != nil {
+			return 0
+		}
+		off += in.length
+		// CMPQ SP/R12, 16(R14)
+		if len(code) == 4 && (code[0] == 0x49 || code[0] == 0x4D) && code[1] == 0x3B && code[2] == 0x66 && code[3] == 0x10 {
+			if in, _, err := instrAt(org + uintptr(off)); err == nil && in.kind == x86Jcc {
+				return off + in.length
+			}
+			return 0
+		}
+	}
+
+	return 0
+}
+
+// displacedEnd returns the offset of the first instruction of function <org>, which follows
+// <size> bytes, overwritten at offset <from>
+func displacedEnd(org uintptr, from, size int) (int, error) {
+	off := from
+	for off < from+size {
+		in, _, err := instrAt(org + uintptr(off))
+		if err != nil {
+			return 0, err
+		}
+		off += in.length
+	}
+
+	return off, nil
+}
+
+/*
+checkBranchTargets returns error, if the function <org> has jumps into the middle of its code
+from offset <from> to <end>, which is moved to the trampoline. Function is scanned up to the
+first instruction, which can't be decoded, so jump tables and rarely used instructions can
+hide such jumps, but Go compiler doesn't jump into the prologue.
+*/
+func checkBranchTargets(org uintptr, from, end int) error {
+	f := runtime.FuncForPC(org)
+	for pc := org; ; {
+		if g := runtime.FuncForPC(pc); g == nil || g.Entry() != f.Entry() {
+			return nil
+		}
+		in, code, err := instrAt(pc)
+		if err != nil {
+			return nil
+		}
+		if in.kind == x86Jmp || in.kind == x86Jcc || in.kind == x86Loop || in.kind == x86Call {
+			target := in.relTarget(pc, code)
+			if target > org+uintptr(from) && target < org+uintptr(end) || target == org+uintptr(from) && from > 0 {
+				return fmt.Errorf("function %s has jump into its prologue", f.Name())
+			}
+		}
+		pc += uintptr(in.length)
+	}
+}
+
+// rel32 appends 32-bit displacement of <target> from the end of instruction, which ends with
+// the displacement followed by <tail> bytes
+func (a *asm) rel32(target uintptr, tail int) error {
+	rel := int64(target) - int64(a.pc()+4+uintptr(tail))
+	if rel != int64(int32(rel)) {
+		return fmt.Errorf("address %#x is out of reach from %#x", target, a.pc())
+	}
+	a.code = binary.LittleEndian.AppendUint32(a.code, uint32(rel))
+
+	return nil
+}
+
+// jmp appends JMP <target>
+func (a *asm) jmp(target uintptr) error {
+	a.emit(0xE9)
+	return a.rel32(target, 0)
+}
+
+// jcc appends conditional jump with condition <cond>, which target is set later with setRel32
+func (a *asm) jcc(cond byte) int {
+	a.emit(0x0F, 0x80|cond, 0, 0, 0, 0)
+	return len(a.code) - 4
+}
+
+// setRel32 sets 32-bit displacement at <off> to point to the end of the code
+func (a *asm) setRel32(off int) {
+	binary.LittleEndian.PutUint32(a.code[off:], uint32(len(a.code)-off-4))
+}
+
+/*
+relocate appends instructions of function <org> from offset <from> to <end>, adjusted for the
+new address, followed by the jump to the rest of the function. CALL is allowed only as the
+last instruction, as it is replaced with the push of the return address into the function,
+followed by the jump, so called function returns straight to the original code.
+*/
+func (a *asm) relocate(org uintptr, from, end int) error {
+	for off := from; off < end; {
+		pc := org + uintptr(off)
+		in, code, err := instrAt(pc)
+		if err != nil {
+			return err
+		}
+		off += in.length
+		last := off >= end
+
+		switch in.kind {
+		case x86Plain:
+			a.emit(code...)
+		case x86RIPRelative:
+			// instruction is copied with displacement, adjusted for the new address
+			a.emit(code[:in.rel]...)
+			if err := a.rel32(in.relTarget(pc, code), in.length-in.rel-4); err != nil {
+				return err
+			}
+			a.emit(code[in.rel+4:]...)
+		case x86Jmp:
+			if err := a.jmp(in.relTarget(pc, code)); err != nil {
+				return err
+			}
+			if last {
+				return nil
+			}
+		case x86Jcc:
+			a.emit(0x0F, 0x80|in.cond)
+			if err := a.rel32(in.relTarget(pc, code), 0); err != nil {
+				return err
+			}
+		case x86Call, x86CallIndirect:
+			if !last {
+				return fmt.Errorf("cannot move CALL at %s+%#x", runtime.FuncForPC(org).Name(), off-in.length)
+			}
+			var jump []byte
+			if in.kind == x86Call {
+				jump = []byte{0xE9, 0, 0, 0, 0}
+				rel := int64(in.relTarget(pc, code)) - int64(a.pc()+6+5)
+				if rel != int64(int32(rel)) {
+					return fmt.Errorf("address %#x is out of reach", in.relTarget(pc, code))
+				}
+				binary.LittleEndian.PutUint32(jump[1:], uint32(rel))
+			} else {
+				// CALL r/m becomes JMP r/m, memory operand must not depend on stack pointer or
+				// instruction pointer, which are different after the push
+				m := code[in.modrm]
+				if m>>6 != 3 && (m&7 == 4 || m&7 == 5) {
+					return fmt.Errorf("cannot move CALL at %s+%#x", runtime.FuncForPC(org).Name(), off-in.length)
+				}
+				jump = append(jump, code...)
+				jump[in.modrm] = m&^0x38 | 4<<3
+			}
+			// PUSHQ return address, which follows the jump; JMP target
+			a.emit(0xFF, 0x35)
+			a.code = binary.LittleEndian.AppendUint32(a.code, uint32(len(jump)))
+			a.emit(jump...)
+			a.code = binary.LittleEndian.AppendUint64(a.code, uint64(org)+uint64(off))
+			return nil
+		default:
+			return fmt.Errorf("cannot move instruction at %s+%#x", runtime.FuncForPC(org).Name(), off-in.length)
+		}
+	}
+
+	return a.jmp(org + uintptr(end))
+}
+
+/*
+callThrough appends the trampoline, which repeats <checkLen> bytes of stack check of function
+<org>, and continues like relocate. If the stack check fails, trampoline sets the failed flag
+of trampolineCall, which is passed in the closure context register, zeroes the registers of
+integer results, so they don't look like pointers, and returns.
+*/
+func (a *asm) callThrough(org uintptr, checkLen, from, end int) error {
+	var fails []int
+	for off := 0; off < checkLen; {
+		in, code, err := instrAt(org + uintptr(off))
+		if err != nil {
+			return err
+		}
+		off += in.length
+		if in.kind == x86Jcc {
+			fails = append(fails, a.jcc(in.cond))
+		} else {
+			a.emit(code...)
+		}
+	}
+	if err := a.relocate(org, from, end); err != nil {
+		return err
+	}
+
+	for _, off := range fails {
+		a.setRel32(off)
+	}
+	a.emit(0xC6, 0x42, 0x08, 0x01) // MOVB $1, 8(DX)
+	a.emit(
+		0x31, 0xC0, 0x31, 0xDB, 0x31, 0xC9, 0x31, 0xFF, 0x31, 0xF6, // XORL AX, AX; BX; CX; DI; SI
+		0x45, 0x31, 0xC0, 0x45, 0x31, 0xC9, 0x45, 0x31, 0xD2, 0x45, 0x31, 0xDB, // XORL R8, R8; R9; R10; R11
+		0xC3, // RET
+	)
+
+	return nil
+}
+
+// closureJump appends the jump to the closure - closure object is passed in the closure context register
+func (a *asm) closureJump(closure unsafe.Pointer) {
+	a.emit(closureJmpCode...)
+	binary.LittleEndian.PutUint64(a.code[len(a.code)-len(closureJmpCode)+2:], uint64(uintptr(closure)))
+}
+
+// increment appends atomic increment of int64 counter at <counter>
+func (a *asm) increment(counter unsafe.Pointer) {
+	a.emit(0x49, 0xBC) // MOVQ $counter, R12
+	a.code = binary.LittleEndian.AppendUint64(a.code, uint64(uintptr(counter)))
+	a.emit(0xF0, 0x49, 0xFF, 0x04, 0x24) // LOCK; INCQ (R12)
+}
+
+// returnG appends the return of the pointer to g of current goroutine, which is kept in R14
+func (a *asm) returnG() {
+	a.emit(0x4C, 0x89, 0xF0) // MOVQ R14, AX
+	a.emit(0xC3)             // RET
+}
+
+// jumpIfSet appends the jump, which is taken if uint32 flag at <flag> isn't zero, and returns
+// its offset to set the target with setJumpTarget
+func (a *asm) jumpIfSet(flag unsafe.Pointer) int {
+	a.emit(0x49, 0xBC) // MOVQ $flag, R12
+	a.code = binary.LittleEndian.AppendUint64(a.code, uint64(uintptr(flag)))
+	a.emit(0x41, 0x83, 0x3C, 0x24, 0x00) // CMPL (R12), $0
+
+	return a.jcc(0x5) // JNE
+}
+
+// setJumpTarget sets the target of the jump at <at> to the end of the code
+func (a *asm) setJumpTarget(at int) {
+	a.setRel32(at)
+}
+
+// hookJump returns the code of the jump from <from> to <to>
+func hookJump(from, to uintptr) ([]byte, error) {
+	a := &asm{base: from}
+	if err := a.jmp(to); err != nil {
+		return nil, err
+	}
+
+	return a.code, nil
+}
+
+func syncCode(ptr unsafe.Pointer, length int) {
+	// instruction cache is coherent on x86
+}
@@ -0,0 +1,27 @@
+package testaroli
+
+import (
+	"runtime"
+	"testing"
+)
+
+// decoding of every function in the binary must end exactly at the start of the next one
+func TestDecodeFunctions(t *testing.T) {
+	for entry, name := range functions().byEntry {
+		pc := entry
+		for {
+			if f := runtime.FuncForPC(pc); f == nil || f.Entry() != entry {
+				if f != nil && f.Entry() != pc {
+					t.Errorf("decoding of %s ends inside %s", name, f.Name())
+				}
+				break
+			}
+			in, _, err := instrAt(pc)
+			if err != nil {
+				t.Error(err)
+				break
+			}
+			pc += uintptr(in.length)
+		}
+	}
+}
@@ -0,0 +1,291 @@
+package testaroli
+
+import (
+	"encoding/binary"
+	"fmt"
+	"runtime"
+	"unsafe"
+)
+
+// trampolines are reached with B instruction, which has 26-bit offset in instructions, ±128MB
+const codeReach = 1 << 26
+
+// patch of the function entry is single B instruction
+const entryJmpLength = instrLength
+
+// LDR X17, #8; BR X17; <address> - jump to any address, X17 is the scratch register
+var absJmpCode = []uint32{0x58000051, 0xD61F0220}
+
+func instrAt(addr uintptr) uint32 {
+	return binary.LittleEndian.Uint32(unsafe.Slice((*byte)(codePointer(addr)), instrLength))
+}
+
+// signExtend returns <bits> low bits of <v> as signed number
+func signExtend(v uint32, bits int) int64 {
+	return int64(int32(v<<(32-bits)) >> (32 - bits))
+}
+
+// branchTarget returns the target of branch instruction <ins> at <pc>, or false, if it isn't a branch
+func branchTarget(pc uintptr, ins uint32) (uintptr, bool) {
+	var rel int64
+	switch {
+	case ins&0x7C000000 == 0x14000000: // B, BL
+		rel = signExtend(ins, 26)
+	case ins&0xFF000010 == 0x54000000, ins&0x7E000000 == 0x34000000: // B.cond, CBZ, CBNZ
+		rel = signExtend(ins>>5, 19)
+	case ins&0x7E000000 == 0x36000000: // TBZ, TBNZ
+		rel = signExtend(ins>>5, 14)
+	default:
+		return 0, false
+	}
+
+	return uintptr(int64(pc) + rel*instrLength), true
+}
+
+/*
+stackCheckLength returns the length of the stack check at the start of Go function <org>, or
+zero, if function doesn't check the stack. Stack check loads the stack guard of the goroutine,
+compares it with stack pointer, or, for large frames, with the stack pointer minus frame size,
+and jumps to the code, which grows the stack, if it's too short:
+
+	MOVD 16(g), R16     or     MOVD 16(g), R16            or     MOVD 16(g), R16
+	CMP  R16, RSP              SUB  $framesize, RSP, R17         MOVD $framesize, R27
+	BLS  morestack             CMP  R16, R17                     SUBS R27, RSP, R17
+	                           BLS  morestack                    BCC  morestack
+	                                                             CMP  R16, R17
+	                                                             BLS  morestack
+*/
+func stackCheckLength(org uintptr) int {
+	if instrAt(org) != 0xF9400B90 { // MOVD 16(R28), R16
+		return 0
+	}
+	var morestack uintptr
+	length := 0
+	for off := instrLength; off < 8*instrLength; off += instrLength {
+		ins := instrAt(org + uintptr(off))
+		if ins&0xFF000010 != 0x54000000 { // not B.cond
+			continue
+		}
+		target, _ := branchTarget(org+uintptr(off), ins)
+		if morestack != 0 && target != morestack {
+			break
+		}
+		morestack, length = target, off+instrLength
+	}
+
+	return length
+}
+
+// displacedEnd returns the offset of the first instruction of function <org>, which follows
+// <size> bytes, overwritten at offset <from>
+func displacedEnd(org uintptr, from, size int) (int, error) {
+	return from + (size+instrLength-1)/instrLength*instrLength, nil
+}
+
+// checkBranchTargets returns error, if the function <org> has jumps into the middle of its code
+// from offset <from> to <end>, which is moved to the trampoline
+func checkBranchTargets(org uintptr, from, end int) error {
+	f := runtime.FuncForPC(org)
+	for pc := org; ; pc += instrLength {
+		if g := runtime.FuncForPC(pc); g == nil || g.Entry() != f.Entry() {
+			return nil
+		}
+		target, ok := branchTarget(pc, instrAt(pc))
+		if ok && (target > org+uintptr(from) && target < org+uintptr(end) || target == org+uintptr(from) && from > 0) {
+			return fmt.Errorf("function %s has jump into its prologue", f.Name())
+		}
+	}
+}
+
+func (a *asm) emit32(ins ...uint32) {
+	for _, i := range ins {
+		a.code = binary.LittleEndian.AppendUint32(a.code, i)
+	}
+}
+
+// setRel sets <bits>-bit offset at bit 5 of instruction at <off> to point to the end of the code
+func (a *asm) setRel(off int, bits int) {
+	mask := uint32(1)<<bits - 1
+	rel := uint32((len(a.code)-off)/instrLength) & mask
+	ins := binary.LittleEndian.Uint32(a.code[off:])
+	binary.LittleEndian.PutUint32(a.code[off:], ins&^(mask<<5)|rel<<5)
+}
+
+// branch appends B <target>, or the absolute jump, if target is too far
+func (a *asm) branch(target uintptr) {
+	rel := int64(target) - int64(a.pc())
+	if rel >= -(1<<27) && rel < 1<<27 {
+		a.emit32(0x14000000 | uint32(rel/instrLength)&0x03FFFFFF)
+		return
+	}
+	a.emit32(absJmpCode...)
+	a.code = binary.LittleEndian.AppendUint64(a.code, uint64(target))
+}
+
+// loadConst appends load of <value> into register X<reg>: LDR X<reg>, #8; B #12; <value>
+func (a *asm) loadConst(reg uint32, value uintptr) {
+	a.emit32(0x58000040|reg, 0x14000003)
+	a.code = binary.LittleEndian.AppendUint64(a.code, uint64(value))
+}
+
+/*
+relocate appends instructions of function <org> from offset <from> to <end>, adjusted for the
+new address, followed by the jump to the rest of the function. Relative addresses are loaded as
+constants, and conditional branches jump to the absolute jumps to their targets, appended at
+the end. BL is allowed only as the last instruction, as it is replaced with the load of the
+return address into the function, followed by the jump, so called function returns straight
+to the original code.
+*/
+func (a *asm) relocate(org uintptr, from, end int) error {
+	type farJump struct {
+		at     int // offset of branch instruction
+		bits   int // number of offset bits
+		target uintptr
+	}
+	var farJumps []farJump
+
+	for off := from; off < end; off += instrLength {
+		pc := org + uintptr(off)
+		ins := instrAt(pc)
+		target, isBranch := branchTarget(pc, ins)
+
+		switch {
+		case ins&0x7C000000 == 0x14000000: // B, BL
+			if ins&0x80000000 != 0 {
+				if off+instrLength < end {
+					return fmt.Errorf("cannot move BL at %s+%#x", runtime.FuncForPC(org).Name(), off)
+				}
+				a.loadConst(30, org+uintptr(end)) // return address
+			}
+			a.branch(target)
+		case isBranch: // B.cond, CBZ, CBNZ, TBZ, TBNZ
+			bits := 19
+			if ins&0x7E000000 == 0x36000000 {
+				bits = 14
+			}
+			farJumps = append(farJumps, farJump{at: len(a.code), bits: bits, target: target})
+			a.emit32(ins)
+		case ins&0x1F000000 == 0x10000000: // ADR, ADRP
+			imm := signExtend(ins>>5&0x7FFFF<<2|ins>>29&3, 21)
+			value := uintptr(int64(pc) + imm)
+			if ins&0x80000000 != 0 {
+				value = uintptr(int64(pc&^0xFFF) + imm<<12)
+			}
+			a.loadConst(ins&0x1F, value)
+		case ins&0x3B000000 == 0x18000000: // LDR (literal), load from the address, loaded into X17
+			addr := uintptr(int64(pc) + signExtend(ins>>5, 19)*instrLength)
+			a.loadConst(17, addr)
+			rt := ins & 0x1F
+			switch ins>>26&1<<2 | ins>>30 { // V, opc
+			case 0:
+				a.emit32(0xB9400220 | rt) // LDR Wt, [X17]
+			case 1:
+				a.emit32(0xF9400220 | rt) // LDR Xt, [X17]
+			case 2:
+				a.emit32(0xB9800220 | rt) // LDRSW Xt, [X17]
+			case 4:
+				a.emit32(0xBD400220 | rt) // LDR St, [X17]
+			case 5:
+				a.emit32(0xFD400220 | rt) // LDR Dt, [X17]
+			case 6:
+				a.emit32(0x3DC00220 | rt) // LDR Qt, [X17]
+			default: // PRFM
+			}
+		default:
+			a.emit32(ins)
+		}
+	}
+	a.branch(org + uintptr(end))
+
+	for _, j := range farJumps {
+		a.setRel(j.at, j.bits)
+		a.branch(j.target)
+	}
+
+	return nil
+}
+
+/*
+callThrough appends the trampoline, which repeats <checkLen> bytes of stack check of function
+<org>, and continues like relocate. If the stack check fails, trampoline sets the failed flag
+of trampolineCall, which is passed in the closure context register, zeroes the registers of
+integer results, so they don't look like pointers, and returns.
+*/
+func (a *asm) callThrough(org uintptr, checkLen, from, end int) error {
+	var fails []int
+	for off := 0; off < checkLen; off += instrLength {
+		ins := instrAt(org + uintptr(off))
+		if ins&0xFF000010 == 0x54000000 { // B.cond
+			fails = append(fails, len(a.code))
+		}
+		a.emit32(ins)
+	}
+	if err := a.relocate(org, from, end); err != nil {
+		return err
+	}
+
+	for _, off := range fails {
+		a.setRel(off, 19)
+	}
+	a.emit32(0xD2800031, 0x39002351) // MOVD $1, R17; MOVB R17, 8(R26)
+	for r := uint32(0); r < 16; r++ {
+		a.emit32(0xAA1F03E0 | r) // MOVD ZR, R<r>
+	}
+	a.emit32(0xD65F03C0) // RET
+
+	return nil
+}
+
+// closureJump appends the jump to the closure - closure object is passed in the closure context register
+func (a *asm) closureJump(closure unsafe.Pointer) {
+	a.emit32(closureJmpCode...)
+	a.code = binary.LittleEndian.AppendUint64(a.code, uint64(uintptr(closure)))
+}
+
+// increment appends atomic increment of int64 counter at <counter>
+func (a *asm) increment(counter unsafe.Pointer) {
+	a.loadConst(17, uintptr(counter))
+	a.emit32(
+		0xC85FFE30, // LDAXR (R17), R16
+		0x91000610, // ADD $1, R16, R16
+		0xC81BFE30, // STLXR R16, (R17), R27
+		0x35FFFFBB, // CBNZW R27, -3(PC)
+	)
+}
+
+// returnG appends the return of the pointer to g of current goroutine, which is kept in R28
+func (a *asm) returnG() {
+	a.emit32(
+		0xAA1C03E0, // MOVD R28, R0
+		0xD65F03C0, // RET
+	)
+}
+
+// jumpIfSet appends the jump, which is taken if uint32 flag at <flag> isn't zero, and returns
+// its offset to set the target with setJumpTarget
+func (a *asm) jumpIfSet(flag unsafe.Pointer) int {
+	a.loadConst(17, uintptr(flag))
+	a.emit32(
+		0xB9400231, // MOVWU (R17), R17
+		0x35000011, // CBNZW R17, <target>
+	)
+
+	return len(a.code) - instrLength
+}
+
+// setJumpTarget sets the target of the jump at <at> to the end of the code
+func (a *asm) setJumpTarget(at int) {
+	a.setRel(at, 19)
+}
+
+// hookJump returns the code of the jump from <from> to <to>
+func hookJump(from, to uintptr) ([]byte, error) {
+	a := &asm{base: from}
+	a.branch(to)
+
+	return a.code, nil
+}
+
+func syncCode(ptr unsafe.Pointer, length int) {
+	flushCache(ptr, length)
+}
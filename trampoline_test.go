@@ -0,0 +1,86 @@
+package testaroli
+
+import (
+	"reflect"
+	"sync"
+	"sync/atomic"
+	"testing"
+)
+
+func fact(n int) int {
+	if n <= 1 {
+		return 1
+	}
+	return n * fact(n-1)
+}
+
+func bigFrame(n int) (int, string) {
+	var buf [64 << 10]byte
+	buf[n] = byte(n)
+	return int(buf[n]), "done"
+}
+
+func TestHookConcurrentCalls(t *testing.T) {
+	var calls atomic.Int64
+	p := newHook(fact, func(p *patch, args []reflect.Value) []reflect.Value {
+		calls.Add(1)
+		return p.call(args)
+	})
+	defer p.remove()
+
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for j := 0; j < 500; j++ {
+				if res := fact(5); res != 120 {
+					t.Errorf("unexpected result %d", res)
+				}
+			}
+		}()
+	}
+	wg.Wait()
+
+	// recursive calls are hooked too
+	if calls.Load() != 8*500*5 {
+		t.Errorf("unexpected number of calls %d", calls.Load())
+	}
+}
+
+func TestOriginalStackGrowth(t *testing.T) {
+	p := newPatch(bigFrame, func(n int) (int, string) { return 0, "" })
+	defer p.remove()
+
+	// new goroutine starts with the small stack, so trampoline fails the stack check
+	done := make(chan struct{})
+	go func() {
+		defer close(done)
+		var n int
+		var s string
+		original(p, func(org func(int) (int, string)) { n, s = org(7) })
+		if n != 7 || s != "done" {
+			t.Errorf("unexpected result %d, %s", n, s)
+		}
+	}()
+	<-done
+}
+
+func TestPatchOriginal(t *testing.T) {
+	p := newPatch(fact, func(n int) int { return 0 })
+	defer p.remove()
+
+	if res := fact(5); res != 0 {
+		t.Errorf("unexpected result %d", res)
+	}
+	var res int
+	original(p, func(org func(int) int) { res = org(5) })
+	// only the outermost call goes to the original function
+	if res != 0 {
+		t.Errorf("unexpected result %d", res)
+	}
+	original(p, func(org func(int) int) { res = org(1) })
+	if res != 1 {
+		t.Errorf("unexpected result %d", res)
+	}
+}
@@ -0,0 +1,69 @@
+package testaroli
+
+import (
+	"context"
+	"fmt"
+)
+
+// closed every time the chain of expectations advances, created only when there is a waiter,
+// protected by chainMu
+var chainChanged chan struct{}
+
+/*
+WaitForCalls blocks until all expected calls are made, i.e. the chain of overrides is
+consumed (override with [Unlimited] count is considered consumed), or until <ctx> is done.
+It is useful when overridden functions are called from background goroutines, so test
+doesn't need to sleep before checking the expectations:
+
+	func TestWorker(t *testing.T) {
+	    Override(TestingContext(t), store, 3, func(item string) error {
+	        Expectation()
+	        return nil
+	    })
+
+	    go worker(items)
+
+	    ctx, cancel := context.WithTimeout(context.Background(), time.Second)
+	    defer cancel()
+	    if err := WaitForCalls(ctx); err != nil {
+	        t.Error(err)
+	    }
+	    if err := ExpectationsWereMet(); err != nil {
+	        t.Error(err)
+	    }
+	}
+
+WaitForCalls is woken up by [Expectation] when it advances the chain, so it returns as soon
+as the last expected call is made. If <ctx> is done earlier, it returns the error, wrapping
+the context's error and naming the function, which call is still expected.
+*/
+func WaitForCalls(ctx context.Context) error {
+	for {
+		chainMu.Lock()
+		e := expectations.front()
+		if e == nil || e.expCount == Unlimited {
+			chainMu.Unlock()
+			return nil
+		}
+		name := e.orgName // expectation can be cleared once lock is released
+		if chainChanged == nil {
+			chainChanged = make(chan struct{})
+		}
+		changed := chainChanged
+		chainMu.Unlock()
+
+		select {
+		case <-changed:
+		case <-ctx.Done():
+			return fmt.Errorf("function %s was not called: %w", name, ctx.Err())
+		}
+	}
+}
+
+// chainAdvanced wakes up WaitForCalls, must be called with chainMu locked
+func chainAdvanced() {
+	if chainChanged != nil {
+		close(chainChanged)
+		chainChanged = nil
+	}
+}
@@ -0,0 +1,65 @@
+package testaroli
+
+import (
+	"context"
+	"errors"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+)
+
+func TestWaitForCalls(t *testing.T) {
+	ctx := TestingContext(t)
+	Override(ctx, baz, 100, func(i int) error {
+		Expectation()
+		return nil
+	})
+	Override(ctx, bar, Once, func(i int) error {
+		Expectation().CheckArgs(i)
+		return nil
+	})(42)
+
+	var wg sync.WaitGroup
+	for i := 0; i < 100; i++ {
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			testError(t, nil, baz(i))
+		}(i)
+	}
+	go func() {
+		wg.Wait()
+		time.Sleep(10 * time.Millisecond)
+		testError(t, nil, bar(42))
+	}()
+
+	timeout, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+	start := time.Now()
+	testError(t, nil, WaitForCalls(timeout))
+	if time.Since(start) > time.Second {
+		t.Errorf("WaitForCalls took too long")
+	}
+	testError(t, nil, ExpectationsWereMet())
+}
+
+func TestWaitForCallsTimeout(t *testing.T) {
+	Override(TestingContext(t), bar, Once, func(i int) error {
+		Expectation()
+		return nil
+	})
+
+	timeout, cancel := context.WithTimeout(context.Background(), 10*time.Millisecond)
+	defer cancel()
+	err := WaitForCalls(timeout)
+	if !errors.Is(err, context.DeadlineExceeded) || !strings.Contains(err.Error(), "testaroli.bar") {
+		t.Errorf("unexpected error %v", err)
+	}
+	if ExpectationsWereMet() == nil {
+		t.Errorf("expectations were met")
+	}
+
+	// nothing to wait for
+	testError(t, nil, WaitForCalls(context.Background()))
+}